@@ -21,23 +21,44 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <iomanip>
 #include <vector>
+#include <algorithm>
+#include <mutex>
 
 #include <cstring>
 #include <assert.h>
 
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
 #include "bin2tape.h"
+#include "tapeencoder.h"
+#include "tapeindex.h"
+#include "tapewav.h"
+#include "tapepack.h"
+#include "buildcache.h"
+#include "../common/hash.h"
+#include "../common/threadpool.h"
+#include "../common/filewatcher.h"
+
+
+#define VERSION "1.04"
 
 
 using namespace std;
 
 void usage(string& moduleName)
 {
-            cout << "Usage: " << moduleName << " [options] input_file.bin [output_file]" << endl << endl <<
+            cout << "Usage: " << moduleName << " [options] input_file.bin [output_file]" << endl <<
+            "       " << moduleName << " [options] -m manifest_file [-j threads]" << endl <<
+            "       " << moduleName << " [options] -c container_file input_file.bin... | -m manifest_file" << endl << endl <<
             "options are:" << endl << endl <<
-            "  -t format" << endl <<
-            "    output file format, available formats are:" << endl << endl <<
+            "  -t format[,format...]" << endl <<
+            "    output file format(s), available formats are:" << endl << endl <<
             "      rk  (RK86 and clones, default)" << endl <<
             "      rkr (Radio-86RK)," << endl <<
             "      rkp (Partner)" << endl <<
@@ -53,6 +74,7 @@ void usage(string& moduleName)
             "      bru, ord (Orion, disk)" << endl <<
             "      lvt (Lvov)" << endl <<
             "      cas (Partner, Apogey, Pk8000, Lvov and others)" << endl << endl <<
+            "    several comma separated formats may be specified, \"all\" means all distinct formats" << endl << endl <<
             "  -a addr" << endl <<
             "    load address (hex), default = 0000 (0100 for .com input files)" << endl << endl <<
             "  -r run_addr" << endl <<
@@ -61,274 +83,812 @@ void usage(string& moduleName)
             "    internal file name (for BRU, RKO, RKS, CAS), default is based on input file name" << endl << endl <<
             "  -n-" << endl <<
             "    no internal file name" << endl << endl <<
-            "output_file - output file name, default is based on input file name" << endl;
+            "  -z" << endl <<
+            "    self-extracting compressed program: packed data is followed by a depacker" << endl <<
+            "    which unpacks the program to its load address and jumps to its run address;" << endl <<
+            "    the program is loaded and started at its load address as usual" << endl << endl <<
+            "  -w" << endl <<
+            "    also write audio file output_file.wav for each format (except bru)" << endl <<
+            "    and report its load time" << endl << endl <<
+            "  -s sample_rate" << endl <<
+            "    audio sample rate (Hz), default = 44100" << endl << endl <<
+            "  -l level" << endl <<
+            "    audio amplitude (percent of full scale), default = 80" << endl << endl <<
+            "  -x speed" << endl <<
+            "    turbo audio mode: speed factor (0.5 ... 4), default = 1;" << endl <<
+            "    stock RK86 compatible loaders adapt to the pilot tone and usually accept up to 2," << endl <<
+            "    MSX compatible (cas, lvt) loaders accept 1 and 2 (2400 baud) only;" << endl <<
+            "    shortest pulse must be at least 2 samples long, so low sample rates limit the speed" << endl << endl <<
+            "  -m manifest_file" << endl <<
+            "    batch mode: convert all entries listed in manifest_file, one per line:" << endl <<
+            "      [options] input_file.bin [output_file]" << endl <<
+            "    options given on the command line are used as defaults for all entries" << endl << endl <<
+            "  -j threads" << endl <<
+            "    number of worker threads in batch mode, default = number of CPU cores" << endl << endl <<
+            "  -k cache_file" << endl <<
+            "    build cache: outputs written with the same input data and options" << endl <<
+            "    are not rewritten (keys are stored in cache_file)" << endl << endl <<
+            "  -u" << endl <<
+            "    watch mode: after conversion keep watching input files (and manifest_file)" << endl <<
+            "    and convert them again each time they are changed, Ctrl+C to stop" << endl << endl <<
+            "  -c container_file" << endl <<
+            "    container mode: pack all input files (or manifest entries) into a single" << endl <<
+            "    multi-program tape image of one format (rk*, rks, rko, cas, lvt);" << endl <<
+            "    index of programs is written to container_file.idx; -z compresses each" << endl <<
+            "    program separately, -w can't be used" << endl << endl <<
+            "output_file - output file name, default is based on input file name" << endl <<
+            "    (if several formats are specified, its extension is replaced with the format name)" << endl << endl <<
+            "\"-\" may be used as input_file.bin for standard input and as output_file for standard" << endl <<
+            "output (default for standard input, only one format; with -w only the audio is written)," << endl <<
+            "messages are written to standard error then" << endl;
 }
 
 
-bool loadFile(string& fileName, vector<uint8_t>& body)
+// standard output saved before messages are redirected to stderr (see main)
+static streambuf* const stdoutBuf = cout.rdbuf();
+
+
+// "-" means standard input, the file is read with a single block read, so pipes are supported
+bool loadFile(const string& fileName, vector<uint8_t>& body)
 {
-    ifstream f(fileName, ofstream::binary);
-    if (f.fail())
+    ifstream f;
+    istream* in = &cin;
+    if (fileName != "-") {
+        f.open(fileName, ifstream::binary);
+        if (f.fail())
+            return false;
+        in = &f;
+    }
+
+    // one extra byte to detect files which are too large
+    body.resize(0x10000 + 1);
+    in->read((char*)(body.data()), body.size());
+    size_t size = in->gcount();
+    if (in->bad() || size > 0x10000)
         return false;
+    body.resize(size);
 
-    f.seekg(0, ios_base::end);
+    return true;
+}
 
-    int size = f.tellg();
 
-    if (size > 0x10000) {
-        f.close();
-        return false;
+// Opens the output file and passes it to writer, "-" means standard output
+template <typename Writer>
+bool writeOutput(const string& outputFile, Writer writer)
+{
+    if (outputFile == "-") {
+        ostream out(stdoutBuf);
+        return writer(out) && out.flush();
     }
 
-    f.seekg(ios_base::beg);
-    body.resize(size);
-    f.read((char*)(body.data()), size);
+    ofstream f(outputFile, ofstream::binary);
     if (f.fail())
         return false;
-
+    bool ok = writer(f);
     f.close();
 
+    return ok && !f.fail();
+}
+
+
+bool convert(const vector<uint8_t>& body, BodyChecksums& checksums, TapeFileFormat format, uint16_t loadAddr, uint16_t startAddr, const string& outputFile, const uint8_t* intFileName)
+{
+    TapeEncodeParams params = {format, loadAddr, startAddr, intFileName};
+
+    uint8_t header[TAPE_MAX_HEADER_SIZE];
+    uint8_t footer[TAPE_MAX_FOOTER_SIZE];
+
+    TapeParts parts;
+    encodeTapeParts(body.data(), body.size(), params, header, footer, parts, &checksums);
+
+    return writeOutput(outputFile, [&parts](ostream& f) {
+        f.write((const char*)parts.header.data, parts.header.size);
+        f.write((const char*)parts.body.data, parts.body.size);
+        f.write((const char*)parts.footer.data, parts.footer.size);
+        return !f.fail();
+    });
+}
+
+
+// Returns load time from tape in seconds at the given audio parameters
+double getLoadTime(const vector<uint8_t>& body, TapeFileFormat format, uint16_t loadAddr, uint16_t startAddr,
+                   const uint8_t* intFileName, const WavParams& wavParams)
+{
+    TapeEncodeParams params = {format, loadAddr, startAddr, intFileName};
+
+    vector<uint8_t> image(getTapeImageSize(format, body.size()));
+    encodeTape(body.data(), body.size(), params, image.data(), image.size());
+
+    return getTapeWavDuration(image.data(), image.size(), format, wavParams);
+}
+
+
+// loadTime receives duration of the audio in seconds
+bool convertToWav(const vector<uint8_t>& body, BodyChecksums& checksums, TapeFileFormat format, uint16_t loadAddr, uint16_t startAddr,
+                  const string& outputFile, const uint8_t* intFileName, const WavParams& wavParams, double& loadTime)
+{
+    TapeEncodeParams params = {format, loadAddr, startAddr, intFileName};
+
+    vector<uint8_t> image(getTapeImageSize(format, body.size()));
+    encodeTape(body.data(), body.size(), params, image.data(), image.size(), &checksums);
+
+    loadTime = getTapeWavDuration(image.data(), image.size(), format, wavParams);
+
+    return writeOutput(outputFile, [&](ostream& f) {
+        return writeTapeWav(image.data(), image.size(), format, wavParams, f);
+    });
+}
+
+
+bool parseFormat(const string& value, TapeFileFormat& format)
+{
+    if (value == "rk" || value == "rkr" || value == "rka" || value == "rk8" || value == "rke" || value == "rkl")
+        format = TFF_RK;
+    else if (value == "rkm")
+        format = TFF_RKM;
+    else if (value == "rku")
+        format = TFF_RKU;
+    else if (value == "rks")
+        format = TFF_RKS;
+    else if (value == "rko")
+        format = TFF_RKO;
+    else if (value == "bru" || value == "ord")
+        format = TFF_BRU;
+    else if (value == "rkp")
+        format = TFF_RKP;
+    else if (value == "rk4")
+        format = TFF_RK4;
+    else if (value == "cas")
+        format = TFF_CAS;
+    else if (value == "lvt")
+        format = TFF_LVT;
+    else
+        return false;
+
     return true;
 }
 
 
-const uint8_t* makeIntName(string baseName, int len)
+bool parseFormatList(string value, vector<TapeFileFormat>& formats, vector<string>& exts)
 {
-    // cut off the extention if any
-    baseName = baseName.substr(0, baseName.find_first_of('.'));
+    if (value == "all")
+        value = "rk,rkp,rkm,rku,rk4,rks,rko,bru,cas,lvt";
 
-    static uint8_t intName[8];
+    formats.clear();
+    exts.clear();
 
-    int i = 0;
-    while (i < len) {
-        char ch = baseName[i];
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t commaPos = value.find(',', pos);
+        if (commaPos == string::npos)
+            commaPos = value.size();
 
-        if (!ch)
-            break;
+        string ext = value.substr(pos, commaPos - pos);
+        TapeFileFormat format;
+        if (!parseFormat(ext, format))
+            return false;
+
+        formats.push_back(format);
+        exts.push_back(ext);
+
+        pos = commaPos + 1;
+    }
+
+    return true;
+}
 
-        if ((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == ' ')
-            ch = ch >= 'a' && ch <= 'z' ? ch - 0x20 : ch;
-        else
-            ch = '-';
 
-        intName[i] = uint8_t(ch);
+// if inputFiles is specified, all file names are added to it
+bool parseJobArgs(const vector<string>& args, ConvertJob& job, string& error, vector<string>* inputFiles = nullptr)
+{
+    unsigned i = 0;
+    string option, value;
+    while (i < args.size()) {
+        option = args[i];
+
+        if (option == "-t" || option == "-a" || option == "-r" || option == "-n" || option == "-s" || option == "-l" || option == "-x") {
+            ++i;
+            if (i >= args.size()) {
+                error = "Missing value for option " + option + "!";
+                return false;
+            }
+            value = args[i];
+        }
+
+        if (option == "-t") {
+            if (!parseFormatList(value, job.formats, job.exts)) {
+                error = "Invalid format specification!";
+                return false;
+            }
+        } else if (option == "-a") {
+            char* numEnd;
+            job.loadAddr = strtoul(value.c_str(), &numEnd, 16);
+            job.loadAddrSpecified = true;
+            if (*numEnd) {
+                error = "Invalid load address!";
+                return false;
+            }
+        } else if (option == "-r") {
+            char* numEnd;
+            job.runAddr = strtoul(value.c_str(), &numEnd, 16);
+            job.runAddrSpecified = true;
+            if (*numEnd) {
+                error = "Invalid run address!";
+                return false;
+            }
+        } else if (option == "-n") {
+            job.intFileName = value;
+            job.intFileSpecified = true;
+        } else if (option == "-n-") {
+            job.intFileName.clear();
+            job.intFileSpecified = true;
+        } else if (option == "-z") {
+            job.compress = true;
+        } else if (option == "-w") {
+            job.wav = true;
+        } else if (option == "-s") {
+            char* numEnd;
+            job.wavParams.sampleRate = strtoul(value.c_str(), &numEnd, 10);
+            if (*numEnd || job.wavParams.sampleRate < 8000 || job.wavParams.sampleRate > 192000) {
+                error = "Invalid sample rate!";
+                return false;
+            }
+        } else if (option == "-l") {
+            char* numEnd;
+            job.wavParams.amplitude = strtoul(value.c_str(), &numEnd, 10);
+            if (*numEnd || !job.wavParams.amplitude || job.wavParams.amplitude > 100) {
+                error = "Invalid audio level!";
+                return false;
+            }
+        } else if (option == "-x") {
+            char* numEnd;
+            job.wavParams.speed = strtod(value.c_str(), &numEnd);
+            if (*numEnd || job.wavParams.speed < 0.5 || job.wavParams.speed > 4) {
+                error = "Invalid speed factor!";
+                return false;
+            }
+        } else {
+            if (option[0] == '-' && option != "-") {
+                error = "Invalid option:" + option;
+                return false;
+            }
+
+            if (inputFiles) {
+                inputFiles->push_back(option);
+            } else if (job.inputFileName.empty()) {
+                job.inputFileName = option;
+            } else if (job.outputFileName.empty()) {
+                job.outputFileName = option;
+            } else {
+                error = "Extra file name specified!";
+                return false;
+            }
+        }
 
         ++i;
     }
 
-    while (i < len)
-        intName[i++] = 0x20;
+    if (job.wav) {
+        for (TapeFileFormat format: job.formats)
+            if (!checkWavParams(format, job.wavParams, error))
+                return false;
+    }
+
+    return true;
+}
+
+
+void getJobParams(const ConvertJob& job, uint16_t& loadAddr, uint16_t& runAddr, string& intFileName)
+{
+    const string& inputFileName = job.inputFileName;
+    string inputFileNameWoPath = inputFileName.substr(inputFileName.find_last_of("/\\:") + 1);
+
+    intFileName = job.intFileSpecified || inputFileName == "-" ? job.intFileName : inputFileNameWoPath;
+
+    loadAddr = job.loadAddr;
+    string inputFileExt = inputFileName.substr(inputFileName.find_last_of('.') + 1);
+    if (!job.loadAddrSpecified && (inputFileExt == "com" || inputFileExt == "COM"))
+        loadAddr = 0x100;
+
+    runAddr = job.runAddrSpecified ? job.runAddr : loadAddr;
+}
 
-    return intName;
+
+// Cache key: input data, format, addresses, internal name and options affecting the output
+uint64_t makeCacheKey(uint64_t inputHash, TapeFileFormat format, uint16_t loadAddr, uint16_t runAddr,
+                      const string& intFileName, bool compress, const WavParams* wavParams = nullptr)
+{
+    ostringstream params;
+    params << VERSION << " " << format << " " << loadAddr << " " << runAddr << " " << compress << " " << intFileName;
+    if (wavParams)
+        params << " " << wavParams->sampleRate << " " << wavParams->amplitude << " " << wavParams->speed;
+
+    string paramStr = params.str();
+    return hash64(paramStr.data(), paramStr.size(), inputHash);
 }
 
 
-uint16_t addToRkCs(uint16_t baseCs, const uint8_t* data, int len, bool lastChunk = false)
+bool processJob(const ConvertJob& job, ostream& log, bool verbose, BuildCache* cache = nullptr)
 {
-    if (lastChunk)
-        --len;
+    const string& inputFileName = job.inputFileName;
+    string inputFileNameWoPath = inputFileName.substr(inputFileName.find_last_of("/\\:") + 1);
+
+    uint16_t loadAddr, runAddr;
+    string intFileName;
+    getJobParams(job, loadAddr, runAddr, intFileName);
+
+    // standard input is converted to standard output by default
+    bool toStdout = job.outputFileName == "-" || (job.outputFileName.empty() && inputFileName == "-");
+    if (toStdout && job.formats.size() > 1) {
+        log << "Only one format can be written to standard output" << endl;
+        return false;
+    }
+
+    vector<uint8_t> body;
+    if (!loadFile(inputFileName, body)) {
+        log << "Input file error: " << inputFileName << endl;
+        return false;
+    }
+
+    if (verbose) {
+        log << "Processing " << inputFileName << ":" << endl;
+        log << "\tLoad address:\t" << setfill('0') << setw(4) << uppercase << hex << loadAddr << endl;
+        log << "\tEnd address:\t" << setfill('0') << setw(4) << uppercase << hex << loadAddr + body.size() - 1 << endl;
+    }
+
+    uint64_t inputHash = cache ? hash64(body.data(), body.size()) : 0;
+
+    // original program is kept to estimate load time saving
+    vector<uint8_t> origBody;
+    uint16_t origLoadAddr = loadAddr;
+    uint16_t origRunAddr = runAddr;
+
+    if (job.compress) {
+        PackedProgram program;
+        if (!makeSelfExtracting(body.data(), body.size(), loadAddr, runAddr, program)) {
+            log << "Compressed program doesn't fit into memory: " << inputFileName << endl;
+            return false;
+        }
 
-    for (int i = 0; i < len; i++) {
-        baseCs += data[i];
-        baseCs += (data[i] << 8);
+        if (program.body.size() < body.size()) {
+            if (verbose) {
+                log << "\tCompressed:\t" << dec << body.size() << " -> " << program.body.size() << " bytes ("
+                    << program.body.size() * 100 / body.size() << "%, depacker included)" << endl;
+            }
+            origBody.swap(body);
+            body.swap(program.body);
+            loadAddr = program.loadAddr;
+            runAddr = program.runAddr;
+        } else if (verbose)
+            log << "\tNot compressible, written as is" << endl;
     }
 
-    if (lastChunk)
-        baseCs = (baseCs & 0xff00) | ((baseCs + data[len]) & 0xff);
+    BodyChecksums checksums;
+
+    for (unsigned f = 0; f < job.formats.size(); f++) {
+        TapeFileFormat format = job.formats[f];
+
+        string fileName;
+        if (toStdout)
+            fileName = "-";
+        else if (job.outputFileName.empty())
+            fileName = inputFileNameWoPath.substr(0, inputFileNameWoPath.find_last_of('.')) + "." + job.exts[f];
+        else if (job.formats.size() > 1)
+            fileName = job.outputFileName.substr(0, job.outputFileName.find_last_of('.')) + "." + job.exts[f];
+        else
+            fileName = job.outputFileName;
+
+        bool writeImage = !toStdout || !job.wav;
+
+        uint8_t intFileNameBuf[8];
+        int intFileNameLen = getIntNameLen(format);
+        if (intFileNameLen)
+            makeIntName(intFileName, intFileNameLen, intFileNameBuf);
+
+        if (verbose) {
+            log << endl;
+            log << "\tFormat:\t\t" << txtFormats[format] << endl;
+            if (format == TFF_CAS || format == TFF_LVT || !origBody.empty())
+                log << "\tRun address:\t" << setfill('0') << setw(4) << uppercase << hex << runAddr << endl;
+            if (format == TFF_CAS || format == TFF_LVT || format == TFF_BRU || format == TFF_RKO) {
+                log << "\tInt. file name:\t";
+                for (int i = 0; i < intFileNameLen; i++)
+                    log << char(intFileNameBuf[i]);
+                log << endl;
+            }
+
+            if (writeImage)
+                log << "Writing " << fileName << " ... ";
+        }
+
+        uint64_t key = 0;
+        bool upToDate = false;
+        if (cache && !toStdout) {
+            key = makeCacheKey(inputHash, format, origLoadAddr, origRunAddr, intFileName, job.compress);
+            upToDate = cache->isUpToDate(fileName, key);
+        }
+
+        if (!writeImage) {
+            // only audio is written to standard output with -w
+        } else if (upToDate) {
+            if (verbose)
+                log << "up to date." << endl;
+        } else {
+            if (!convert(body, checksums, format, loadAddr, runAddr, fileName, intFileNameBuf)) {
+                if (verbose)
+                    log << "error!" << endl;
+                else
+                    log << "Error writing " << fileName << endl;
+                return false;
+            }
+
+            if (cache && !toStdout)
+                cache->update(fileName, key);
 
-    return baseCs;
+            if (verbose)
+                log << "done." << endl;
+        }
+
+        if (!upToDate && !origBody.empty() && isWavSupported(format)) {
+            int origTime = int(getLoadTime(origBody, format, origLoadAddr, origRunAddr, intFileNameBuf, job.wavParams) + 0.5);
+            int packedTime = int(getLoadTime(body, format, loadAddr, runAddr, intFileNameBuf, job.wavParams) + 0.5);
+            if (verbose)
+                log << "\tLoad time:\t";
+            else
+                log << "\t" << fileName << ": load time ";
+            log << dec << packedTime / 60 << ":" << setfill('0') << setw(2) << packedTime % 60 << " instead of "
+                << origTime / 60 << ":" << setw(2) << origTime % 60 << " (" << origTime - packedTime << " s saved)" << endl;
+        }
+
+        if (job.wav && isWavSupported(format)) {
+            string wavFileName = toStdout ? "-" : fileName + ".wav";
+
+            if (verbose)
+                log << "Writing " << wavFileName << " ... ";
+
+            uint64_t wavKey = 0;
+            if (cache && !toStdout) {
+                wavKey = makeCacheKey(inputHash, format, origLoadAddr, origRunAddr, intFileName, job.compress, &job.wavParams);
+                if (cache->isUpToDate(wavFileName, wavKey)) {
+                    if (verbose)
+                        log << "up to date." << endl;
+                    continue;
+                }
+            }
+
+            double loadTime;
+            if (!convertToWav(body, checksums, format, loadAddr, runAddr, wavFileName, intFileNameBuf, job.wavParams, loadTime)) {
+                if (verbose)
+                    log << "error!" << endl;
+                else
+                    log << "Error writing " << wavFileName << endl;
+                return false;
+            }
+
+            if (cache && !toStdout)
+                cache->update(wavFileName, wavKey);
+
+            int seconds = int(loadTime + 0.5);
+            if (verbose)
+                log << "done." << endl << "\tLoad time:\t";
+            else
+                log << "\t" << wavFileName << ": load time ";
+            log << dec << seconds / 60 << ":" << setfill('0') << setw(2) << seconds % 60;
+            if (job.wavParams.speed != 1)
+                log << " (speed x" << job.wavParams.speed << ")";
+            log << endl;
+        }
+    }
+
+    return true;
 }
 
 
-uint16_t calcRkCs(vector<uint8_t>& data)
+bool loadManifest(const string& manifestFileName, const ConvertJob& defaultJob, vector<ConvertJob>& jobs)
 {
-    return addToRkCs(0, data.data(), data.size(), true);
+    ifstream f(manifestFileName);
+    if (f.fail()) {
+        cout << "Error opening manifest file " << manifestFileName << endl;
+        return false;
+    }
+
+    bool ok = true;
+    int lineNum = 0;
+    string line;
+    while (getline(f, line)) {
+        ++lineNum;
+
+        // split the line into arguments, double quotes may be used for names with spaces
+        vector<string> args;
+        string arg;
+        bool inArg = false;
+        bool quoted = false;
+        for (char ch: line) {
+            if (ch == '"') {
+                quoted = !quoted;
+                inArg = true;
+            } else if (!quoted && (ch == ' ' || ch == '\t' || ch == '\r')) {
+                if (inArg)
+                    args.push_back(arg);
+                arg.clear();
+                inArg = false;
+            } else if (!quoted && !inArg && ch == '#') {
+                break; // comment
+            } else {
+                arg.push_back(ch);
+                inArg = true;
+            }
+        }
+        if (inArg)
+            args.push_back(arg);
+
+        if (args.empty())
+            continue;
+
+        ConvertJob job = defaultJob;
+        string error;
+        if (!parseJobArgs(args, job, error) || job.inputFileName.empty()) {
+            cout << manifestFileName << ", line " << dec << lineNum << ": " << (error.empty() ? "No input file name specified!" : error) << endl;
+            ok = false;
+            continue;
+        }
+        jobs.push_back(job);
+    }
+
+    return ok;
+}
+
+
+int processJobs(const vector<ConvertJob>& jobs, int nThreads, BuildCache* cache)
+{
+    mutex coutMutex;
+    vector<bool> results(jobs.size());
+
+    runParallel(jobs.size(), [&](int n) {
+        ostringstream log;
+        bool ok = processJob(jobs[n], log, false, cache);
+
+        lock_guard<mutex> lock(coutMutex);
+        results[n] = ok;
+        if (ok)
+            cout << jobs[n].inputFileName << ": done." << endl << log.str();  // load times if any
+        else
+            cout << jobs[n].inputFileName << ": " << log.str();
+    }, nThreads);
+
+    int nErrors = 0;
+    for (bool ok: results)
+        if (!ok)
+            ++nErrors;
+
+    cout << endl << dec << jobs.size() - nErrors << " of " << jobs.size() << " entries converted";
+    if (nErrors)
+        cout << ", " << nErrors << " failed";
+    cout << "." << endl;
+
+    return nErrors;
 }
 
 
-uint16_t calcRkmCs(vector<uint8_t>& data)
+int processManifest(const string& manifestFileName, const ConvertJob& defaultJob, int nThreads, BuildCache* cache)
 {
-    uint16_t cs = 0;
-    for (uint16_t i = 0; i < data.size(); i++)
-        cs ^= i & 1 ? data.data()[i] << 8 : data.data()[i];
-    return cs;
+    vector<ConvertJob> jobs;
+    bool manifestOk = loadManifest(manifestFileName, defaultJob, jobs);
+
+    return processJobs(jobs, nThreads, cache) == 0 && manifestOk ? 0 : 1;
 }
 
 
-uint16_t calcRkuCs(vector<uint8_t>& data)
+static string getWatchedName(const string& fileName)
 {
-    uint16_t cs = 0;
-    for (uint16_t i = 0; i < data.size(); i++)
-        cs += data.data()[i];
-    return cs;
+    string dirName, name;
+    splitFileName(fileName, dirName, name);
+    return dirName + "/" + name;
 }
 
 
-bool convert(vector<uint8_t> body, TapeFileFormat format, uint16_t loadAddr, uint16_t startAddr, string& outputFile, const uint8_t* intFileName)
+// Watch mode: converts jobs again when their input files are changed.
+// If the manifest itself is changed, it is reloaded and all its entries are converted.
+// Never returns unless an error occurs.
+int watchJobs(const string& manifestFileName, const ConvertJob& defaultJob, int nThreads, BuildCache* cache)
 {
-    int endAddr = loadAddr + body.size() - 1;
-
-    int headerSize = 0;
-    int footerSize = 0;
-
-    FileHeader header;
-    FileFooter footer;
-
-    const char* headerPtr = (const char*)&header;
-    const char* footerPtr = (const char*)&footer;
-
-    uint16_t cs;
-    int paddingSize;
-
-    switch (format) {
-    case TFF_RK:
-    case TFF_RKP:
-    case TFF_RKM:
-    case TFF_RKU:
-    case TFF_RK4:
-        headerSize = sizeof(RkHeader);
-        header.rkHeader.loadAddrHi = loadAddr >> 8;
-        header.rkHeader.loadAddrLo = loadAddr & 0xFF;
-        header.rkHeader.endAddrHi = endAddr >> 8;
-        header.rkHeader.endAddrLo = endAddr & 0xFF;
-
-        switch (format) {
-        case TFF_RKM:
-            cs = calcRkmCs(body);
-            break;
-        case TFF_RKU:
-            cs = calcRkuCs(body);
-            break;
-        default:
-            cs = calcRkCs(body);
+    FileWatcher watcher;
+    if (!watcher.isValid()) {
+        cout << "Watch mode is not supported on this platform!" << endl;
+        return 1;
+    }
+
+    vector<ConvertJob> jobs;
+    if (manifestFileName.empty())
+        jobs.push_back(defaultJob);
+    else
+        loadManifest(manifestFileName, defaultJob, jobs);
+
+    auto addWatches = [&]() {
+        vector<string> fileNames;
+        for (const ConvertJob& job: jobs)
+            fileNames.push_back(job.inputFileName);
+        if (!manifestFileName.empty())
+            fileNames.push_back(manifestFileName);
+
+        bool ok = true;
+        for (const string& fileName: fileNames) {
+            string dirName, name;
+            splitFileName(fileName, dirName, name);
+            if (!watcher.addDir(dirName)) {
+                cout << "Can't watch directory " << dirName << "!" << endl;
+                ok = false;
+            }
         }
+        return ok;
+    };
+
+    if (!addWatches())
+        return 1;
 
-        if (format == TFF_RK || format == TFF_RKU) {
-            footerSize = sizeof(RkFooter);
-            footer.rkFooter.nullByte1 = 0;
-            footer.rkFooter.nullByte2 = 0;
-            footer.rkFooter.syncByte = 0xE6;
-            footer.rkFooter.csHi = cs >> 8;
-            footer.rkFooter.csLo = cs & 0xFF;
-        } else if (format == TFF_RKP) {
-            footerSize = sizeof(RkpFooter);
-            footer.rkpFooter.nullByte = 0;
-            footer.rkpFooter.syncByte = 0xE6;
-            footer.rkpFooter.csHi = cs >> 8;
-            footer.rkpFooter.csLo = cs & 0xFF;
-        } else if (format == TFF_RK4) {
-            footerSize = sizeof(Rk4Footer);
-            memset(footer.rk4Footer.nullBytes, 0, sizeof(footer.rk4Footer.nullBytes));
-            footer.rk4Footer.syncByte = 0xE6;
-            footer.rk4Footer.csHi1= cs >> 8;
-            footer.rk4Footer.csLo1 = cs & 0xFF;
-            footer.rk4Footer.csHi2= cs >> 8;
-            footer.rk4Footer.csLo2 = cs & 0xFF;
-        } else if (format == TFF_RKM) {
-            footerSize = sizeof(RkmFooter);
-            footer.rkmFooter.csHi = cs >> 8;
-            footer.rkmFooter.csLo = cs & 0xFF;
+    string watchedManifest = manifestFileName.empty() ? "" : getWatchedName(manifestFileName);
+
+    cout << endl << "Watching for changes..." << endl;
+
+    for (;;) {
+        vector<string> changedFiles, deletedFiles;
+        if (!watcher.wait(changedFiles, deletedFiles))
+            return 1;
+
+        vector<ConvertJob> changedJobs;
+        if (!watchedManifest.empty() && find(changedFiles.begin(), changedFiles.end(), watchedManifest) != changedFiles.end()) {
+            cout << endl << manifestFileName << " changed, reloading" << endl;
+            jobs.clear();
+            loadManifest(manifestFileName, defaultJob, jobs);
+            addWatches();
+            changedJobs = jobs;
+        } else {
+            for (const ConvertJob& job: jobs)
+                if (find(changedFiles.begin(), changedFiles.end(), getWatchedName(job.inputFileName)) != changedFiles.end())
+                    changedJobs.push_back(job);
         }
-        break;
-    case TFF_RKS:
-        cs = calcRkCs(body);
-
-        headerSize = sizeof(RksHeader);
-        header.rksHeader.loadAddrHi = loadAddr >> 8;
-        header.rksHeader.loadAddrLo = loadAddr & 0xFF;
-        header.rksHeader.endAddrHi = endAddr >> 8;
-        header.rksHeader.endAddrLo = endAddr & 0xFF;
-
-        footerSize = sizeof(RksFooter);
-        footer.rksFooter.csHi = cs >> 8;
-        footer.rksFooter.csLo = cs & 0xFF;
-        break;
-    case TFF_BRU:
-        headerSize = sizeof(BruHeader);
-        memcpy(&header.bruHeader.name, intFileName, 8);
-        header.bruHeader.loadAddrHi = loadAddr >> 8;
-        header.bruHeader.loadAddrLo = loadAddr & 0xFF;
-        header.bruHeader.lenHi = (endAddr - loadAddr + 1) >> 8;
-        header.bruHeader.lenLo = (endAddr - loadAddr + 1) & 0xFF;
-        header.bruHeader.attr = 0;
-        memset(header.bruHeader.ff, 0xFF, sizeof(header.bruHeader.ff));
-        footerSize = 0;
-        break;
-    case TFF_RKO:
-        headerSize = sizeof(RkoHeader);
-
-        memcpy(&header.rkoHeader.name, intFileName, 8);
-        header.rkoHeader.loadAddrHi = loadAddr >> 8;
-        header.rkoHeader.loadAddrLo = loadAddr & 0xFF;
-        header.rkoHeader.lenHi = (endAddr - loadAddr + 1 + 16) >> 8;
-        header.rkoHeader.lenLo = (endAddr - loadAddr + 1 + 16) & 0xFF;
-        header.rkoHeader.syncByte = 0xE6;
-        memset(header.rkoHeader.nullBytes, 0, sizeof(header.rkoHeader.nullBytes));
-
-        header.rkoHeader.bruHeader.loadAddrHi = loadAddr >> 8;
-        header.rkoHeader.bruHeader.loadAddrLo = loadAddr & 0xFF;
-        header.rkoHeader.bruHeader.lenHi = (endAddr - loadAddr + 1) >> 8;
-        header.rkoHeader.bruHeader.lenLo = (endAddr - loadAddr + 1) & 0xFF;
-        header.rkoHeader.bruHeader.attr = 0;
-        memset(header.rkoHeader.bruHeader.ff, 0xFF, sizeof(header.rkoHeader.bruHeader.ff));
-        memcpy(&header.rkoHeader.bruHeader.name, intFileName, 8);
-
-        memset(footer.rkoFooter.padding, 0, sizeof(footer.rkoFooter.padding));
-        footer.rkoFooter.syncByte = 0xE6;
-
-        cs = addToRkCs(0, (uint8_t*)(&header.rkoHeader.bruHeader), sizeof(BruHeader), false);
-        cs = addToRkCs(cs, body.data(), body.size(), false);
-        cs = addToRkCs(cs, footer.rkoFooter.padding, 3, true);
-
-        footer.rkoFooter.csHi = cs >> 8;
-        footer.rkoFooter.csLo = cs & 0xFF;
-        paddingSize = (-headerSize - body.size()) & 0x0F;
-        footerSize = paddingSize + 3 /* syncByte + csHi + csLo */;
-        footerPtr += (sizeof(footer.rkoFooter.padding) - paddingSize);
-        break;
-    case TFF_CAS:
-        headerSize = sizeof(CasHeader);
-        memcpy(&header.casHeader.name, intFileName, 6);
-        header.casHeader.loadAddrHi = loadAddr >> 8;
-        header.casHeader.loadAddrLo = loadAddr & 0xFF;
-        header.casHeader.endAddrHi = endAddr >> 8;
-        header.casHeader.endAddrLo = endAddr & 0xFF;
-        header.casHeader.runAddrHi = startAddr >> 8;
-        header.casHeader.runAddrLo = startAddr & 0xFF;
-        memset(header.casHeader.d0, 0xD0, sizeof(header.casHeader.d0));
-        memset(header.casHeader.padding, 0, sizeof(header.casHeader.padding));
-        memcpy(header.casHeader.casSignature1, casSignature, sizeof(header.casHeader.casSignature1));
-        memcpy(header.casHeader.casSignature2, casSignature, sizeof(header.casHeader.casSignature2));
-        footerSize = 0;
-        break;
-    case TFF_LVT:
-        headerSize = sizeof(LvtHeader);
-        memcpy(&header.lvtHeader.name, intFileName, 6);
-        header.lvtHeader.loadAddrHi = loadAddr >> 8;
-        header.lvtHeader.loadAddrLo = loadAddr & 0xFF;
-        header.lvtHeader.endAddrHi = endAddr >> 8;
-        header.lvtHeader.endAddrLo = endAddr & 0xFF;
-        header.lvtHeader.runAddrHi = startAddr >> 8;
-        header.lvtHeader.runAddrLo = startAddr & 0xFF;
-        header.lvtHeader.d0 = 0xD0;
-        memcpy(header.lvtHeader.lvtSignature, lvtSignature, sizeof(header.lvtHeader.lvtSignature));
-        footerSize = 0;
-        break;
+
+        if (changedJobs.empty())
+            continue;
+
+        cout << endl;
+        if (manifestFileName.empty())
+            processJob(changedJobs[0], cout, true, cache);
+        else
+            processJobs(changedJobs, nThreads, cache);
+
+        if (cache && !cache->save())
+            cout << "Error writing cache file!" << endl;
+
+        cout << endl << "Watching for changes..." << endl;
     }
+}
 
-    ofstream f(outputFile, ofstream::binary);
-    if (f.fail())
-        return false;
-    f.write(headerPtr, headerSize);
-    f.write((const char*)(body.data()), body.size());
-    f.write(footerPtr, footerSize);
-    if (f.fail()) {
-        f.close();
-        return false;
+
+int buildContainer(const string& containerFileName, const vector<ConvertJob>& jobs)
+{
+    if (jobs.empty()) {
+        cout << "No input files!" << endl;
+        return 1;
+    }
+
+    TapeFileFormat format = jobs[0].formats[0];
+    for (const ConvertJob& job: jobs) {
+        if (job.formats.size() != 1 || job.formats[0] != format || format == TFF_BRU) {
+            cout << "Container requires a single format (rk*, rks, rko, cas or lvt) for all programs!" << endl;
+            return 1;
+        }
+        if (!job.outputFileName.empty()) {
+            cout << "Output file name can't be used in container mode: " << job.outputFileName << endl;
+            return 1;
+        }
+        if (job.wav) {
+            cout << "Audio output (-w) can't be used in container mode: " << job.inputFileName << endl;
+            return 1;
+        }
+    }
+
+    // RK-like images have no signature, so each one is preceded with the sync byte as on tape
+    bool writeSyncByte = format != TFF_RKO && format != TFF_CAS && format != TFF_LVT;
+    static const char syncByte = char(0xE6);
+
+    string indexFileName = containerFileName + ".idx";
+
+    ofstream f(containerFileName, ofstream::binary);
+    ofstream indexFile(indexFileName);
+    if (f.fail() || indexFile.fail()) {
+        cout << "Error creating " << containerFileName << "!" << endl;
+        return 1;
+    }
+
+    writeTapeIndexHeader(indexFile);
+
+    cout << "Writing " << containerFileName << " (" << txtFormats[format] << "):" << endl;
+
+    uint64_t offset = 0;
+    int n = 0;
+    int nErrors = 0;
+
+    // programs are loaded, encoded and written one by one, so only one body is kept in memory
+    for (const ConvertJob& job: jobs) {
+        uint16_t loadAddr, runAddr;
+        string intFileName;
+        getJobParams(job, loadAddr, runAddr, intFileName);
+
+        vector<uint8_t> body;
+        if (!loadFile(job.inputFileName, body)) {
+            cout << "\tInput file error: " << job.inputFileName << endl;
+            ++nErrors;
+            continue;
+        }
+
+        // compressed as in processJob, the program is kept as is if it doesn't get smaller
+        size_t origSize = body.size();
+        if (job.compress) {
+            PackedProgram program;
+            if (!makeSelfExtracting(body.data(), body.size(), loadAddr, runAddr, program)) {
+                cout << "\tCompressed program doesn't fit into memory: " << job.inputFileName << endl;
+                ++nErrors;
+                continue;
+            }
+            if (program.body.size() < body.size()) {
+                body.swap(program.body);
+                loadAddr = program.loadAddr;
+                runAddr = program.runAddr;
+            }
+        }
+
+        uint8_t intFileNameBuf[8];
+        int intFileNameLen = getIntNameLen(format);
+        if (intFileNameLen)
+            makeIntName(intFileName, intFileNameLen, intFileNameBuf);
+
+        TapeEncodeParams params = {format, loadAddr, runAddr, intFileNameBuf};
+        uint8_t header[TAPE_MAX_HEADER_SIZE];
+        uint8_t footer[TAPE_MAX_FOOTER_SIZE];
+        TapeParts parts;
+        encodeTapeParts(body.data(), body.size(), params, header, footer, parts);
+
+        if (writeSyncByte) {
+            f.write(&syncByte, 1);
+            ++offset;
+        }
+
+        f.write((const char*)parts.header.data, parts.header.size);
+        f.write((const char*)parts.body.data, parts.body.size);
+        f.write((const char*)parts.footer.data, parts.footer.size);
+        if (f.fail()) {
+            cout << "Error writing " << containerFileName << "!" << endl;
+            return 1;
+        }
+
+        TapeIndexEntry entry = {offset, parts.header.size + parts.body.size + parts.footer.size, format,
+                                loadAddr, uint16_t(loadAddr + body.size() - 1), runAddr, string(), job.inputFileName};
+        entry.intFileName.assign((const char*)intFileNameBuf, intFileNameLen);
+        entry.intFileName.erase(entry.intFileName.find_last_not_of(' ') + 1);
+        writeTapeIndexEntry(indexFile, ++n, entry);
+
+        cout << "\t" << dec << n << ": " << job.inputFileName << " at " << offset << ", "
+             << setfill('0') << setw(4) << uppercase << hex << loadAddr << "-" << setw(4) << entry.endAddr;
+        if (job.compress && body.size() < origSize)
+            cout << dec << ", compressed " << origSize << " -> " << body.size() << " bytes";
+        else if (job.compress)
+            cout << ", not compressible";
+        cout << endl;
+
+        offset += entry.size;
     }
+
     f.close();
+    indexFile.close();
+    if (indexFile.fail()) {
+        cout << "Error writing " << indexFileName << "!" << endl;
+        return 1;
+    }
 
-    return true;
+    cout << endl << dec << n << " program(s), " << offset << " bytes written, index: " << indexFileName << endl;
+
+    return nErrors ? 1 : 0;
 }
 
 
@@ -336,24 +896,20 @@ int main(int argc, const char** argv)
 {
     static_assert(sizeof(RkFooter) == 5, "Packed structs required!");
 
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    // standard output may be used for tape data, messages go to stderr in this case
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "-")
+            cout.rdbuf(cerr.rdbuf());
+
     cout << "bin2tape v. " VERSION " (c) Viktor Pykhonin, 2021-2023" << endl << endl;
     string moduleName = argv[0];
     moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
 
-    TapeFileFormat format  = TFF_RK;
-    string ext = "rk";
-    uint16_t loadAddr = 0;
-    uint16_t runAddr = 0;
-    string intFileName;
-    string inputFileName;
-    string outputFileName;
-
-    bool loadAddrSpecified = false;
-    bool runAddrSpecified = false;
-    bool intFileSpecified = false;
-    bool inputFileSpecified = false;
-    bool outputFileSpecified = false;
-
     // parse command line
 
     if (argc < 2) {
@@ -361,172 +917,102 @@ int main(int argc, const char** argv)
         return 1;
     }
 
-    int i = 1;
-    string option, value;
-    while (i < argc) {
-        option = argv[i];
-
-        if (option == "-t") {
-            ++i;
-            if (i > argc) {
+    string manifestFileName;
+    string containerFileName;
+    string cacheFileName;
+    int nThreads = 0;
+    bool watch = false;
+
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "-m" || option == "-j" || option == "-c" || option == "-k") {
+            if (++i >= argc) {
                 usage(moduleName);
                 return 1;
             }
-            value = argv[i];
-            ext = value;
-
-            if (value == "rk" || value == "rkr" || value == "rka" || value == "rk8" || value == "rke" || value == "rkl")
-                format = TFF_RK;
-            else if (value == "rkm")
-                format = TFF_RKM;
-            else if (value == "rku")
-                format = TFF_RKU;
-            else if (value == "rks")
-                format = TFF_RKS;
-            else if (value == "rko")
-                format = TFF_RKO;
-            else if (value == "bru" || value == "ord")
-                format = TFF_BRU;
-            else if (value == "rkp")
-                format = TFF_RKP;
-            else if (value == "rk4")
-                format = TFF_RK4;
-            else if (value == "cas")
-                format = TFF_CAS;
-            else if (value == "lvt")
-                format = TFF_LVT;
+            if (option == "-m")
+                manifestFileName = argv[i];
+            else if (option == "-c")
+                containerFileName = argv[i];
+            else if (option == "-k")
+                cacheFileName = argv[i];
             else {
-                cout << "Invalid format specification!" << endl << endl;
-                usage(moduleName);
-                return 1;
-            }
-        } else if (option == "-a") {
-            ++i;
-            if (i > argc) {
-                usage(moduleName);
-                return 1;
+                char* numEnd;
+                nThreads = strtoul(argv[i], &numEnd, 10);
+                if (*numEnd) {
+                    cout << "Invalid number of threads!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
             }
-            value = argv[i];
+        } else if (option == "-u")
+            watch = true;
+        else
+            args.push_back(option);
+    }
 
-            char* numEnd;
-            loadAddr = strtoul(value.c_str(), &numEnd, 16);
-            loadAddrSpecified = true;
-            if (*numEnd) {
-                cout << "Invalid load address!" << endl << endl;
-                usage(moduleName);
-                return 1;
-            }
-        } else if (option == "-r") {
-            ++i;
-            if (i > argc) {
-                usage(moduleName);
-                return 1;
-            }
-            value = argv[i];
+    ConvertJob job;
+    string error;
+    vector<string> inputFiles;
+    if (!parseJobArgs(args, job, error, containerFileName.empty() ? nullptr : &inputFiles)) {
+        if (!error.empty())
+            cout << error << endl << endl;
+        usage(moduleName);
+        return 1;
+    }
 
-            char* numEnd;
-            runAddr = strtoul(value.c_str(), &numEnd, 16);
-            runAddrSpecified = true;
-            if (*numEnd) {
-                cout << "Invalid run address!" << endl << endl;
+    if (!containerFileName.empty()) {
+        vector<ConvertJob> jobs;
+        if (!manifestFileName.empty()) {
+            if (!inputFiles.empty()) {
+                cout << "Input file name can't be used with manifest!" << endl << endl;
                 usage(moduleName);
                 return 1;
             }
-        } else if (option == "-n") {
-            ++i;
-            if (i > argc) {
-                usage(moduleName);
+            if (!loadManifest(manifestFileName, job, jobs))
                 return 1;
-            }
-            value = argv[i];
-
-            intFileName = value;
-            intFileSpecified = true;
-        } else if (option == "-n-") {
-            intFileSpecified = true;
         } else {
-            if (option[0] == '-') {
-                cout << "Invalid option:" << option << endl << endl;
-                usage(moduleName);
-                return 1;
-            }
-
-            if (!inputFileSpecified) {
-                inputFileName = option;
-                inputFileSpecified = true;
-            } else if (!outputFileSpecified) {
-                outputFileName = option;
-                outputFileSpecified = true;
-            } else {
-                usage(moduleName);
-                return 1;
+            for (const string& inputFile: inputFiles) {
+                jobs.push_back(job);
+                jobs.back().inputFileName = inputFile;
             }
         }
-
-        ++i;
+        return buildContainer(containerFileName, jobs);
     }
 
-    if (!inputFileSpecified) {
-        cout << "No input file name specified!" << endl << endl;
+    if (!manifestFileName.empty() && !job.inputFileName.empty()) {
+        cout << "Input file name can't be used with manifest!" << endl << endl;
         usage(moduleName);
         return 1;
     }
 
-    string inputFileNameWoPath = inputFileName.substr(inputFileName.find_last_of("/\\:") + 1);
-
-    if (!intFileSpecified)
-        intFileName = inputFileNameWoPath;
-
-    string inputFileExt = inputFileName.substr(inputFileName.find_last_of('.') + 1);
-    if (!loadAddrSpecified && (inputFileExt == "com" || inputFileExt == "COM"))
-        loadAddr = 0x100;
-
-    if (!runAddrSpecified)
-        runAddr = loadAddr;
-
-    if (!outputFileSpecified)
-        outputFileName = inputFileNameWoPath.substr(0, inputFileNameWoPath.find_last_of('.')) + "." + ext;
-
-    const uint8_t* intFileNameBuf = nullptr;
-    int intFileNameLen = 0;
-
-    if (format == TFF_BRU || format == TFF_RKO)
-        intFileNameLen = 8;
-    else if (format == TFF_CAS || format == TFF_LVT)
-        intFileNameLen = 6;
-
-    if (intFileNameLen)
-        intFileNameBuf = makeIntName(intFileName, intFileNameLen);
-
-    vector<uint8_t> body;
-    if (!loadFile(inputFileName, body)) {
-        cout << "Input file error" << endl;
+    if (manifestFileName.empty() && job.inputFileName.empty()) {
+        cout << "No input file name specified!" << endl << endl;
+        usage(moduleName);
         return 1;
     }
 
-    cout << "Processing " << inputFileName << ":" << endl;
-    cout << "\tFormat:\t\t" << txtFormats[format] << endl;
-    cout << "\tLoad address:\t" << setfill('0') << setw(4) << uppercase << hex << loadAddr << endl;
-    cout << "\tEnd address:\t" << setfill('0') << setw(4) << uppercase << hex << loadAddr + body.size() - 1 << endl;
-    if (format == TFF_CAS || format == TFF_LVT)
-        cout << "\tRun address:\t" << setfill('0') << setw(4) << uppercase << hex << runAddr << endl;
-    if (format == TFF_CAS || format == TFF_LVT || format == TFF_BRU || format == TFF_RKO) {
-        cout << "\tInt. file name:\t";
-        for (int i = 0; i < intFileNameLen; i++)
-            cout << char(intFileNameBuf[i]);
-        cout << endl;
+    BuildCache cache;
+    if (!cacheFileName.empty() && !cache.load(cacheFileName)) {
+        cout << "Error reading cache file " << cacheFileName << endl;
+        return 1;
     }
+    BuildCache* cachePtr = cacheFileName.empty() ? nullptr : &cache;
 
-    cout << endl;
-
-    cout << "Writing " << outputFileName << " ... ";
+    int res;
+    if (!manifestFileName.empty())
+        res = processManifest(manifestFileName, job, nThreads, cachePtr);
+    else
+        res = processJob(job, cout, true, cachePtr) ? 0 : 1;
 
-    if (!convert(body, format, loadAddr, runAddr, outputFileName, intFileNameBuf)) {
-        cout << "error!" << endl;
+    if (cachePtr && !cache.save()) {
+        cout << "Error writing cache file " << cacheFileName << endl;
         return 1;
     }
 
-    cout << "done." << endl;
+    if (watch)
+        res = watchJobs(manifestFileName, job, nThreads, cachePtr);
 
-    return 0;
+    return res;
 }
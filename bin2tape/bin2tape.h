@@ -27,8 +27,6 @@
 #include <vector>
 #include <string>
 
-#define VERSION "1.03"
-
 
 static const uint8_t casSignature[8] = {0x1F, 0xA6, 0xDE, 0xBA, 0xCC, 0x13, 0x7D, 0x74};
 static const uint8_t lvtSignature[9] = {0x4C, 0x56, 0x4F, 0x56, 0x2F, 0x32, 0x2E, 0x30, 0x2F}; // "LVOV/2.0/"
@@ -48,7 +46,50 @@ enum TapeFileFormat {
 };
 
 
-const char* txtFormats[] = {"RK compatible", "RKP (RK compatible)", "RKM", "RKU", "RK4 (RK compatible)", "RKS", "RKO", "BRU", "CAS", "LVT"};
+enum ChecksumType {
+    CST_RK,
+    CST_RKM,
+    CST_RKU,
+    CST_RKO,  // RK checksum of the BRU header and body
+    CST_NONE
+};
+
+
+// body checksums (CST_RK, CST_RKM, CST_RKU) shared between formats
+struct BodyChecksums {
+    uint16_t cs[3];
+    bool calculated[3] = {false, false, false};
+};
+
+
+// audio rendering parameters, see tapewav.h
+struct WavParams {
+    unsigned sampleRate = 44100;
+    unsigned amplitude = 80;  // percent of full scale
+    double speed = 1;         // turbo factor, bit rate is multiplied by it
+};
+
+
+struct ConvertJob {
+    std::vector<TapeFileFormat> formats = {TFF_RK};
+    std::vector<std::string> exts = {"rk"};
+    uint16_t loadAddr = 0;
+    uint16_t runAddr = 0;
+    std::string intFileName;
+    std::string inputFileName;
+    std::string outputFileName;
+
+    bool wav = false;
+    WavParams wavParams;
+    bool compress = false;
+
+    bool loadAddrSpecified = false;
+    bool runAddrSpecified = false;
+    bool intFileSpecified = false;
+};
+
+
+static const char* const txtFormats[] = {"RK compatible", "RKP (RK compatible)", "RKM", "RKU", "RK4 (RK compatible)", "RKS", "RKO", "BRU", "CAS", "LVT"};
 
 
 #pragma pack(push, 1)
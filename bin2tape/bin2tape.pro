@@ -4,9 +4,28 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
-    bin2tape.cpp
+    bin2tape.cpp \
+    tapeencoder.cpp \
+    tapedecoder.cpp \
+    tapeindex.cpp \
+    tapewav.cpp \
+    tapepack.cpp \
+    buildcache.cpp \
+    ../common/filewatcher.cpp
 
 HEADERS += \
-    bin2tape.h
+    bin2tape.h \
+    tapeencoder.h \
+    tapeformat.h \
+    tapedecoder.h \
+    tapeindex.h \
+    tapewav.h \
+    tapepack.h \
+    buildcache.h \
+    ../common/hash.h \
+    ../common/filewatcher.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
 
 QMAKE_LFLAGS += -static -static-libgcc
@@ -0,0 +1,116 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/stat.h>
+
+#include "buildcache.h"
+
+
+using namespace std;
+
+
+static bool getFileSize(const string& fileName, uint64_t& size)
+{
+    struct stat st;
+    if (stat(fileName.c_str(), &st) || !S_ISREG(st.st_mode))
+        return false;
+    size = st.st_size;
+    return true;
+}
+
+
+bool BuildCache::load(const string& fileName)
+{
+    m_fileName = fileName;
+
+    ifstream f(fileName);
+    if (f.fail())
+        return true;
+
+    // each line: key size file_name
+    string line;
+    while (getline(f, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        istringstream ss(line);
+        Entry entry;
+        string outputFileName;
+        if (!(ss >> hex >> entry.key >> dec >> entry.size) || !getline(ss >> ws, outputFileName))
+            return false;
+        m_entries[outputFileName] = entry;
+    }
+
+    return !f.bad();
+}
+
+
+bool BuildCache::save()
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (!m_modified)
+        return true;
+
+    ofstream f(m_fileName);
+    if (f.fail())
+        return false;
+
+    f << "# bin2tape build cache: key size file" << endl;
+    for (const auto& entry: m_entries)
+        f << hex << setfill('0') << setw(16) << entry.second.key << " " << dec << entry.second.size << " " << entry.first << endl;
+
+    f.close();
+    if (f.fail())
+        return false;
+
+    m_modified = false;
+    return true;
+}
+
+
+bool BuildCache::isUpToDate(const string& outputFileName, uint64_t key)
+{
+    uint64_t size;
+    if (!getFileSize(outputFileName, size))
+        return false;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    auto it = m_entries.find(outputFileName);
+    return it != m_entries.end() && it->second.key == key && it->second.size == size;
+}
+
+
+void BuildCache::update(const string& outputFileName, uint64_t key)
+{
+    uint64_t size;
+    if (!getFileSize(outputFileName, size))
+        return;
+
+    lock_guard<mutex> lock(m_mutex);
+
+    m_entries[outputFileName] = {key, size};
+    m_modified = true;
+}
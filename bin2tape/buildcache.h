@@ -0,0 +1,57 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <mutex>
+
+
+// Keeps keys (hashes of input data and conversion parameters) of the written output
+// files, so unchanged outputs are not rewritten. Methods are thread safe.
+class BuildCache
+{
+public:
+    // missing cache file is not an error
+    bool load(const std::string& fileName);
+    bool save();
+
+    // true if the output was written with the same key and wasn't changed since then
+    bool isUpToDate(const std::string& outputFileName, uint64_t key);
+
+    void update(const std::string& outputFileName, uint64_t key);
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint64_t size;
+    };
+
+    std::string m_fileName;
+    std::map<std::string, Entry> m_entries;
+    std::mutex m_mutex;
+    bool m_modified = false;
+};
+
+#endif // BUILDCACHE_H
@@ -0,0 +1,197 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "tapedecoder.h"
+#include "tapeformat.h"
+
+
+using namespace std;
+
+
+template <TapeFileFormat F>
+TapeDecodeResult decodeFormat(const uint8_t* data, size_t size, TapeImageInfo& info)
+{
+    typedef TapeFormat<F> Format;
+    typedef typename Format::Header Header;
+    typedef typename Format::Footer Footer;
+
+    if (size < sizeof(Header))
+        return TDR_UNKNOWN_FORMAT;
+
+    const Header& header = *reinterpret_cast<const Header*>(data);
+
+    uint16_t loadAddr, runAddr;
+    const uint8_t* intFileName;
+    size_t bodySize;
+    if (!parseHeader(header, loadAddr, runAddr, intFileName, bodySize))
+        return TDR_UNKNOWN_FORMAT;
+
+    size_t footerSize = Format::footerSize(bodySize);
+    size_t imageSize = sizeof(Header) + bodySize + footerSize;
+    if (imageSize > size)
+        return TDR_UNKNOWN_FORMAT;
+
+    const uint8_t* body = data + sizeof(Header);
+
+    // footer struct is aligned to the end of the image (RKO padding may be shorter than in the struct)
+    uint16_t storedCs = 0;
+    if (footerSize) {
+        const Footer& footer = *reinterpret_cast<const Footer*>(data + imageSize - sizeof(Footer));
+        if (!parseFooter(footer, storedCs))
+            return TDR_UNKNOWN_FORMAT;
+    }
+
+    BodyChecksums checksums;
+    uint16_t calculatedCs = calcTapeCs(Format::csType, header, body, bodySize, checksums);
+    bool csOk = storedCs == calculatedCs;
+
+    // formats w/o sync byte or signature are recognized only by checksum or by exact file size
+    if (!csOk && (F == TFF_RKM || F == TFF_RKS) && imageSize != size)
+        return TDR_UNKNOWN_FORMAT;
+
+    info.format = F;
+    info.loadAddr = loadAddr;
+    info.endAddr = loadAddr + bodySize - 1;
+    info.runAddr = runAddr;
+    info.hasRunAddr = F == TFF_CAS || F == TFF_LVT;
+    if (intFileName) {
+        info.intFileName.assign(reinterpret_cast<const char*>(intFileName), Format::nameLen);
+        info.intFileName.erase(info.intFileName.find_last_not_of(' ') + 1);
+    } else
+        info.intFileName.clear();
+    info.body = body;
+    info.bodySize = bodySize;
+    info.imageOffset = 0;
+    info.imageSize = imageSize;
+    info.storedCs = storedCs;
+    info.calculatedCs = calculatedCs;
+
+    return csOk ? TDR_OK : TDR_BAD_CHECKSUM;
+}
+
+
+typedef TapeDecodeResult (*TapeDecoderFunc)(const uint8_t*, size_t, TapeImageInfo&);
+
+
+// indexed by TapeFileFormat
+static const TapeDecoderFunc c_decoders[] = {
+    &decodeFormat<TFF_RK>,
+    &decodeFormat<TFF_RKP>,
+    &decodeFormat<TFF_RKM>,
+    &decodeFormat<TFF_RKU>,
+    &decodeFormat<TFF_RK4>,
+    &decodeFormat<TFF_RKS>,
+    &decodeFormat<TFF_RKO>,
+    &decodeFormat<TFF_BRU>,
+    &decodeFormat<TFF_CAS>,
+    &decodeFormat<TFF_LVT>
+};
+
+static_assert(sizeof(c_decoders) / sizeof(c_decoders[0]) == TFF_LVT + 1, "Format table mismatch!");
+
+
+// formats with signatures go first, RK4 before RK (both footers start with null bytes)
+static const TapeFileFormat c_detectionOrder[] = {TFF_CAS, TFF_LVT, TFF_RKO, TFF_BRU, TFF_RK4, TFF_RK, TFF_RKU, TFF_RKP, TFF_RKS, TFF_RKM};
+
+
+TapeDecodeResult decodeTapeFormat(const uint8_t* data, size_t size, TapeFileFormat format, TapeImageInfo& info)
+{
+    return c_decoders[format](data, size, info);
+}
+
+
+TapeDecodeResult decodeTape(const uint8_t* data, size_t size, TapeImageInfo& info, const TapeFileFormat* preferredFormats, int nPreferredFormats)
+{
+    vector<TapeFileFormat> formats(preferredFormats, preferredFormats + nPreferredFormats);
+    for (TapeFileFormat format: c_detectionOrder)
+        if (find(formats.begin(), formats.end(), format) == formats.end())
+            formats.push_back(format);
+
+    TapeImageInfo badCsInfo;
+    bool badCsFound = false;
+
+    for (TapeFileFormat format: formats) {
+        bool rkLike = format != TFF_CAS && format != TFF_LVT && format != TFF_RKO && format != TFF_BRU;
+
+        // RK-like images may start with the sync byte
+        for (size_t offset = 0; offset <= (rkLike && size && data[0] == 0xE6 ? 1u : 0u); offset++) {
+            TapeImageInfo curInfo;
+            TapeDecodeResult res = decodeTapeFormat(data + offset, size - offset, format, curInfo);
+            curInfo.imageOffset = offset;
+            if (res == TDR_OK) {
+                info = curInfo;
+                return TDR_OK;
+            } else if (res == TDR_BAD_CHECKSUM && !badCsFound) {
+                badCsInfo = curInfo;
+                badCsFound = true;
+            }
+        }
+    }
+
+    if (badCsFound) {
+        info = badCsInfo;
+        return TDR_BAD_CHECKSUM;
+    }
+
+    return TDR_UNKNOWN_FORMAT;
+}
+
+
+int getFormatsByExt(string ext, TapeFileFormat* formats)
+{
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == "rk" || ext == "rkr" || ext == "rka" || ext == "rk8" || ext == "rke" || ext == "rkl")
+        formats[0] = TFF_RK;
+    else if (ext == "rkp")
+        formats[0] = TFF_RKP;
+    else if (ext == "rkm")
+        formats[0] = TFF_RKM;
+    else if (ext == "rku")
+        formats[0] = TFF_RKU;
+    else if (ext == "rk4")
+        formats[0] = TFF_RK4;
+    else if (ext == "rks")
+        formats[0] = TFF_RKS;
+    else if (ext == "rko")
+        formats[0] = TFF_RKO;
+    else if (ext == "bru" || ext == "ord")
+        formats[0] = TFF_BRU;
+    else if (ext == "cas")
+        formats[0] = TFF_CAS;
+    else if (ext == "lvt")
+        formats[0] = TFF_LVT;
+    else
+        return 0;
+
+    return 1;
+}
+
+
+const char* getFormatExt(TapeFileFormat format)
+{
+    static const char* const exts[] = {"rk", "rkp", "rkm", "rku", "rk4", "rks", "rko", "bru", "cas", "lvt"};
+    return exts[format];
+}
@@ -0,0 +1,70 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEDECODER_H
+#define TAPEDECODER_H
+
+#include <cstddef>
+#include <string>
+
+#include "bin2tape.h"
+
+
+enum TapeDecodeResult {
+    TDR_OK,
+    TDR_BAD_CHECKSUM,   // structure is recognized, checksum doesn't match
+    TDR_UNKNOWN_FORMAT
+};
+
+
+struct TapeImageInfo {
+    TapeFileFormat format;
+    uint16_t loadAddr;
+    uint16_t endAddr;
+    uint16_t runAddr;
+    bool hasRunAddr;
+    std::string intFileName;  // empty if the format has no internal name
+
+    const uint8_t* body;      // points into the decoded image
+    size_t bodySize;
+    size_t imageOffset;       // offset of the header in the decoded data (leading sync byte etc.)
+    size_t imageSize;         // header + body + footer
+
+    uint16_t storedCs;
+    uint16_t calculatedCs;
+};
+
+
+// Recognizes the format of a tape image, parses it and verifies its checksum.
+// Formats listed in preferredFormats (e.g. guessed by extension) are tried first.
+TapeDecodeResult decodeTape(const uint8_t* data, size_t size, TapeImageInfo& info,
+                            const TapeFileFormat* preferredFormats = nullptr, int nPreferredFormats = 0);
+
+// Same as decodeTape but only for the given format, data must start with the header
+TapeDecodeResult decodeTapeFormat(const uint8_t* data, size_t size, TapeFileFormat format, TapeImageInfo& info);
+
+// Returns formats matching a file extension (rk, rkm, rks, cas etc.)
+int getFormatsByExt(std::string ext, TapeFileFormat* formats);
+
+// Returns default file extension for a format
+const char* getFormatExt(TapeFileFormat format);
+
+#endif // TAPEDECODER_H
@@ -0,0 +1,233 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <string>
+
+#include <cstring>
+
+#include "tapeencoder.h"
+#include "tapeformat.h"
+
+
+using namespace std;
+
+
+void makeIntName(string baseName, int len, uint8_t* intName)
+{
+    // cut off the extention if any
+    baseName = baseName.substr(0, baseName.find_first_of('.'));
+
+    int i = 0;
+    while (i < len && i < int(baseName.size())) {
+        char ch = baseName[i];
+
+        if (!ch)
+            break;
+
+        if ((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == ' ')
+            ch = ch >= 'a' && ch <= 'z' ? ch - 0x20 : ch;
+        else
+            ch = '-';
+
+        intName[i] = uint8_t(ch);
+
+        ++i;
+    }
+
+    while (i < len)
+        intName[i++] = 0x20;
+}
+
+
+uint16_t addToRkCs(uint16_t baseCs, const uint8_t* data, int len, bool lastChunk)
+{
+    if (lastChunk)
+        --len;
+
+    for (int i = 0; i < len; i++) {
+        baseCs += data[i];
+        baseCs += (data[i] << 8);
+    }
+
+    if (lastChunk)
+        baseCs = (baseCs & 0xff00) | ((baseCs + data[len]) & 0xff);
+
+    return baseCs;
+}
+
+
+uint16_t calcRkCs(const uint8_t* data, size_t size)
+{
+    return addToRkCs(0, data, size, true);
+}
+
+
+uint16_t calcRkmCs(const uint8_t* data, size_t size)
+{
+    uint16_t cs = 0;
+    for (size_t i = 0; i < size; i++)
+        cs ^= i & 1 ? data[i] << 8 : data[i];
+    return cs;
+}
+
+
+uint16_t calcRkuCs(const uint8_t* data, size_t size)
+{
+    uint16_t cs = 0;
+    for (size_t i = 0; i < size; i++)
+        cs += data[i];
+    return cs;
+}
+
+
+uint16_t getBodyCs(const uint8_t* body, size_t bodySize, ChecksumType type, BodyChecksums& checksums)
+{
+    // each checksum is calculated only once per input file and then shared between formats
+    if (!checksums.calculated[type]) {
+        switch (type) {
+        case CST_RK:
+            checksums.cs[type] = calcRkCs(body, bodySize);
+            break;
+        case CST_RKM:
+            checksums.cs[type] = calcRkmCs(body, bodySize);
+            break;
+        case CST_RKU:
+            checksums.cs[type] = calcRkuCs(body, bodySize);
+            break;
+        default:
+            return 0;
+        }
+        checksums.calculated[type] = true;
+    }
+
+    return checksums.cs[type];
+}
+
+
+template <TapeFileFormat F>
+void encodeFormat(const uint8_t* body, size_t bodySize, const TapeEncodeParams& params,
+                  uint8_t* headerBuf, uint8_t* footerBuf, TapeParts& parts, BodyChecksums& checksums)
+{
+    typedef TapeFormat<F> Format;
+
+    typename Format::Header& header = *reinterpret_cast<typename Format::Header*>(headerBuf);
+    typename Format::Footer& footer = *reinterpret_cast<typename Format::Footer*>(footerBuf);
+
+    fillHeader(header, params.loadAddr, params.runAddr, params.intFileName, bodySize);
+
+    uint16_t cs = calcTapeCs(Format::csType, header, body, bodySize, checksums);
+    size_t footerSize = Format::footerSize(bodySize);
+
+    parts.header.data = headerBuf;
+    parts.header.size = sizeof(typename Format::Header);
+    parts.body.data = body;
+    parts.body.size = bodySize;
+    parts.footer.data = fillFooter(footer, cs, footerSize);
+    parts.footer.size = footerSize;
+}
+
+
+typedef void (*TapeEncoderFunc)(const uint8_t*, size_t, const TapeEncodeParams&, uint8_t*, uint8_t*, TapeParts&, BodyChecksums&);
+
+
+struct TapeFormatInfo {
+    size_t headerSize;
+    int nameLen;
+    size_t (*footerSize)(size_t bodySize);
+    TapeEncoderFunc encode;
+};
+
+
+template <TapeFileFormat F>
+constexpr TapeFormatInfo makeFormatInfo()
+{
+    return {sizeof(typename TapeFormat<F>::Header), TapeFormat<F>::nameLen, &TapeFormat<F>::footerSize, &encodeFormat<F>};
+}
+
+
+// indexed by TapeFileFormat
+static const TapeFormatInfo c_formats[] = {
+    makeFormatInfo<TFF_RK>(),
+    makeFormatInfo<TFF_RKP>(),
+    makeFormatInfo<TFF_RKM>(),
+    makeFormatInfo<TFF_RKU>(),
+    makeFormatInfo<TFF_RK4>(),
+    makeFormatInfo<TFF_RKS>(),
+    makeFormatInfo<TFF_RKO>(),
+    makeFormatInfo<TFF_BRU>(),
+    makeFormatInfo<TFF_CAS>(),
+    makeFormatInfo<TFF_LVT>()
+};
+
+static_assert(sizeof(c_formats) / sizeof(c_formats[0]) == TFF_LVT + 1, "Format table mismatch!");
+
+
+int getIntNameLen(TapeFileFormat format)
+{
+    return c_formats[format].nameLen;
+}
+
+
+size_t getTapeHeaderSize(TapeFileFormat format)
+{
+    return c_formats[format].headerSize;
+}
+
+
+size_t getTapeFooterSize(TapeFileFormat format, size_t bodySize)
+{
+    return c_formats[format].footerSize(bodySize);
+}
+
+
+size_t getTapeImageSize(TapeFileFormat format, size_t bodySize)
+{
+    return getTapeHeaderSize(format) + bodySize + getTapeFooterSize(format, bodySize);
+}
+
+
+void encodeTapeParts(const uint8_t* body, size_t bodySize, const TapeEncodeParams& params,
+                     uint8_t* headerBuf, uint8_t* footerBuf, TapeParts& parts, BodyChecksums* checksums)
+{
+    BodyChecksums localChecksums;
+    c_formats[params.format].encode(body, bodySize, params, headerBuf, footerBuf, parts, checksums ? *checksums : localChecksums);
+}
+
+
+size_t encodeTape(const uint8_t* body, size_t bodySize, const TapeEncodeParams& params,
+                  uint8_t* outBuf, size_t outBufSize, BodyChecksums* checksums)
+{
+    size_t size = getTapeImageSize(params.format, bodySize);
+    if (size > outBufSize)
+        return 0;
+
+    uint8_t header[TAPE_MAX_HEADER_SIZE];
+    uint8_t footer[TAPE_MAX_FOOTER_SIZE];
+
+    TapeParts parts;
+    encodeTapeParts(body, bodySize, params, header, footer, parts, checksums);
+
+    memcpy(outBuf, parts.header.data, parts.header.size);
+    memcpy(outBuf + parts.header.size, parts.body.data, parts.body.size);
+    memcpy(outBuf + parts.header.size + parts.body.size, parts.footer.data, parts.footer.size);
+
+    return size;
+}
@@ -0,0 +1,83 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEENCODER_H
+#define TAPEENCODER_H
+
+#include <cstddef>
+
+#include "bin2tape.h"
+
+
+// Tape image encoder. All functions are reentrant: they use no static data
+// and never copy or allocate the program body.
+
+const size_t TAPE_MAX_HEADER_SIZE = sizeof(FileHeader);
+const size_t TAPE_MAX_FOOTER_SIZE = sizeof(FileFooter);
+
+
+struct TapeEncodeParams {
+    TapeFileFormat format;
+    uint16_t loadAddr;
+    uint16_t runAddr;            // CAS and LVT only
+    const uint8_t* intFileName;  // BRU, RKO (8 chars), CAS, LVT (6 chars), see makeIntName()
+};
+
+
+// one part of the output image, same layout as struct iovec
+struct TapeChunk {
+    const uint8_t* data;
+    size_t size;
+};
+
+
+// header, body and footer of the output image
+struct TapeParts {
+    TapeChunk header;
+    TapeChunk body;
+    TapeChunk footer;
+};
+
+
+void makeIntName(std::string baseName, int len, uint8_t* intName);
+int getIntNameLen(TapeFileFormat format);
+
+uint16_t addToRkCs(uint16_t baseCs, const uint8_t* data, int len, bool lastChunk = false);
+uint16_t calcRkCs(const uint8_t* data, size_t size);
+uint16_t calcRkmCs(const uint8_t* data, size_t size);
+uint16_t calcRkuCs(const uint8_t* data, size_t size);
+uint16_t getBodyCs(const uint8_t* body, size_t bodySize, ChecksumType type, BodyChecksums& checksums);
+
+size_t getTapeHeaderSize(TapeFileFormat format);
+size_t getTapeFooterSize(TapeFileFormat format, size_t bodySize);
+size_t getTapeImageSize(TapeFileFormat format, size_t bodySize);
+
+// Fills header and footer into caller provided buffers of at least TAPE_MAX_HEADER_SIZE
+// and TAPE_MAX_FOOTER_SIZE bytes, parts.body points to the original body.
+// checksums may be shared between calls for the same body.
+void encodeTapeParts(const uint8_t* body, size_t bodySize, const TapeEncodeParams& params,
+                     uint8_t* headerBuf, uint8_t* footerBuf, TapeParts& parts, BodyChecksums* checksums = nullptr);
+
+// Writes the whole image into outBuf, returns its size or 0 if outBufSize is too small
+size_t encodeTape(const uint8_t* body, size_t bodySize, const TapeEncodeParams& params,
+                  uint8_t* outBuf, size_t outBufSize, BodyChecksums* checksums = nullptr);
+
+#endif // TAPEENCODER_H
@@ -0,0 +1,368 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEFORMAT_H
+#define TAPEFORMAT_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "bin2tape.h"
+#include "tapeencoder.h"
+
+
+// Compile-time tape format descriptors.
+//
+// TapeFormat<format> names the header and footer structs of the format, its checksum
+// algorithm and internal file name length. Headers and footers (with their byte order)
+// are filled (and parsed) by the fillHeader()/fillFooter() (parseHeader()/parseFooter())
+// overloads below, which are selected by the struct type, so each format gets its own
+// fully inlined encoder and decoder (see encodeFormat() in tapeencoder.cpp and
+// decodeFormat() in tapedecoder.cpp).
+//
+// To add a format: add a TapeFileFormat value, its header/footer structs (if new)
+// with fill/parse overloads and a TapeFormat<> specialization.
+
+struct NoFooter {};
+
+
+template <typename H, typename F, ChecksumType CS, int NameLen>
+struct TapeFormatBase {
+    typedef H Header;
+    typedef F Footer;
+
+    static constexpr ChecksumType csType = CS;
+    static constexpr int nameLen = NameLen;
+
+    static size_t footerSize(size_t /*bodySize*/) {return std::is_empty<F>::value ? 0 : sizeof(F);}
+};
+
+
+template <TapeFileFormat F> struct TapeFormat;
+
+template <> struct TapeFormat<TFF_RK>  : TapeFormatBase<RkHeader, RkFooter, CST_RK, 0> {};
+template <> struct TapeFormat<TFF_RKP> : TapeFormatBase<RkHeader, RkpFooter, CST_RK, 0> {};
+template <> struct TapeFormat<TFF_RKM> : TapeFormatBase<RkHeader, RkmFooter, CST_RKM, 0> {};
+template <> struct TapeFormat<TFF_RKU> : TapeFormatBase<RkHeader, RkFooter, CST_RKU, 0> {};
+template <> struct TapeFormat<TFF_RK4> : TapeFormatBase<RkHeader, Rk4Footer, CST_RK, 0> {};
+template <> struct TapeFormat<TFF_RKS> : TapeFormatBase<RksHeader, RksFooter, CST_RK, 0> {};
+template <> struct TapeFormat<TFF_BRU> : TapeFormatBase<BruHeader, NoFooter, CST_NONE, 8> {};
+template <> struct TapeFormat<TFF_CAS> : TapeFormatBase<CasHeader, NoFooter, CST_NONE, 6> {};
+template <> struct TapeFormat<TFF_LVT> : TapeFormatBase<LvtHeader, NoFooter, CST_NONE, 6> {};
+
+template <> struct TapeFormat<TFF_RKO> : TapeFormatBase<RkoHeader, RkoFooter, CST_RKO, 8> {
+    // body is padded to 16 bytes boundary
+    static size_t footerSize(size_t bodySize) {return ((-sizeof(RkoHeader) - bodySize) & 0x0F) + 3 /* syncByte + csHi + csLo */;}
+};
+
+
+// headers
+
+inline void fillHeader(RkHeader& header, uint16_t loadAddr, uint16_t /*runAddr*/, const uint8_t* /*intFileName*/, size_t bodySize)
+{
+    int endAddr = loadAddr + bodySize - 1;
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.endAddrHi = endAddr >> 8;
+    header.endAddrLo = endAddr & 0xFF;
+}
+
+
+inline void fillHeader(RksHeader& header, uint16_t loadAddr, uint16_t /*runAddr*/, const uint8_t* /*intFileName*/, size_t bodySize)
+{
+    int endAddr = loadAddr + bodySize - 1;
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.endAddrHi = endAddr >> 8;
+    header.endAddrLo = endAddr & 0xFF;
+}
+
+
+inline void fillHeader(BruHeader& header, uint16_t loadAddr, uint16_t /*runAddr*/, const uint8_t* intFileName, size_t bodySize)
+{
+    memcpy(&header.name, intFileName, 8);
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.lenHi = bodySize >> 8;
+    header.lenLo = bodySize & 0xFF;
+    header.attr = 0;
+    memset(header.ff, 0xFF, sizeof(header.ff));
+}
+
+
+inline void fillHeader(RkoHeader& header, uint16_t loadAddr, uint16_t runAddr, const uint8_t* intFileName, size_t bodySize)
+{
+    memcpy(&header.name, intFileName, 8);
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.lenHi = (bodySize + 16) >> 8;
+    header.lenLo = (bodySize + 16) & 0xFF;
+    header.syncByte = 0xE6;
+    memset(header.nullBytes, 0, sizeof(header.nullBytes));
+
+    fillHeader(header.bruHeader, loadAddr, runAddr, intFileName, bodySize);
+}
+
+
+inline void fillHeader(CasHeader& header, uint16_t loadAddr, uint16_t runAddr, const uint8_t* intFileName, size_t bodySize)
+{
+    int endAddr = loadAddr + bodySize - 1;
+    memcpy(&header.name, intFileName, 6);
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.endAddrHi = endAddr >> 8;
+    header.endAddrLo = endAddr & 0xFF;
+    header.runAddrHi = runAddr >> 8;
+    header.runAddrLo = runAddr & 0xFF;
+    memset(header.d0, 0xD0, sizeof(header.d0));
+    memset(header.padding, 0, sizeof(header.padding));
+    memcpy(header.casSignature1, casSignature, sizeof(header.casSignature1));
+    memcpy(header.casSignature2, casSignature, sizeof(header.casSignature2));
+}
+
+
+inline void fillHeader(LvtHeader& header, uint16_t loadAddr, uint16_t runAddr, const uint8_t* intFileName, size_t bodySize)
+{
+    int endAddr = loadAddr + bodySize - 1;
+    memcpy(&header.name, intFileName, 6);
+    header.loadAddrHi = loadAddr >> 8;
+    header.loadAddrLo = loadAddr & 0xFF;
+    header.endAddrHi = endAddr >> 8;
+    header.endAddrLo = endAddr & 0xFF;
+    header.runAddrHi = runAddr >> 8;
+    header.runAddrLo = runAddr & 0xFF;
+    header.d0 = 0xD0;
+    memcpy(header.lvtSignature, lvtSignature, sizeof(header.lvtSignature));
+}
+
+
+// footers, return pointer to the first footer byte to be written
+
+inline const uint8_t* fillFooter(RkFooter& footer, uint16_t cs, size_t /*footerSize*/)
+{
+    footer.nullByte1 = 0;
+    footer.nullByte2 = 0;
+    footer.syncByte = 0xE6;
+    footer.csHi = cs >> 8;
+    footer.csLo = cs & 0xFF;
+    return reinterpret_cast<uint8_t*>(&footer);
+}
+
+
+inline const uint8_t* fillFooter(RkpFooter& footer, uint16_t cs, size_t /*footerSize*/)
+{
+    footer.nullByte = 0;
+    footer.syncByte = 0xE6;
+    footer.csHi = cs >> 8;
+    footer.csLo = cs & 0xFF;
+    return reinterpret_cast<uint8_t*>(&footer);
+}
+
+
+inline const uint8_t* fillFooter(Rk4Footer& footer, uint16_t cs, size_t /*footerSize*/)
+{
+    memset(footer.nullBytes, 0, sizeof(footer.nullBytes));
+    footer.syncByte = 0xE6;
+    footer.csHi1 = cs >> 8;
+    footer.csLo1 = cs & 0xFF;
+    footer.csHi2 = cs >> 8;
+    footer.csLo2 = cs & 0xFF;
+    return reinterpret_cast<uint8_t*>(&footer);
+}
+
+
+inline const uint8_t* fillFooter(RkmFooter& footer, uint16_t cs, size_t /*footerSize*/)
+{
+    footer.csHi = cs >> 8;
+    footer.csLo = cs & 0xFF;
+    return reinterpret_cast<uint8_t*>(&footer);
+}
+
+
+inline const uint8_t* fillFooter(RksFooter& footer, uint16_t cs, size_t /*footerSize*/)
+{
+    footer.csHi = cs >> 8;
+    footer.csLo = cs & 0xFF;
+    return reinterpret_cast<uint8_t*>(&footer);
+}
+
+
+inline const uint8_t* fillFooter(RkoFooter& footer, uint16_t cs, size_t footerSize)
+{
+    memset(footer.padding, 0, sizeof(footer.padding));
+    footer.syncByte = 0xE6;
+    footer.csHi = cs >> 8;
+    footer.csLo = cs & 0xFF;
+    // only the tail of the padding is written
+    return reinterpret_cast<uint8_t*>(&footer) + sizeof(RkoFooter) - footerSize;
+}
+
+
+inline const uint8_t* fillFooter(NoFooter& /*footer*/, uint16_t /*cs*/, size_t /*footerSize*/)
+{
+    return nullptr;
+}
+
+
+// header parsing (for decoding), return false if the header doesn't look valid
+
+inline bool parseHeader(const RkHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    loadAddr = (header.loadAddrHi << 8) | header.loadAddrLo;
+    int endAddr = (header.endAddrHi << 8) | header.endAddrLo;
+    runAddr = loadAddr;
+    intFileName = nullptr;
+    bodySize = endAddr - loadAddr + 1;
+    return endAddr >= loadAddr;
+}
+
+
+inline bool parseHeader(const RksHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    loadAddr = (header.loadAddrHi << 8) | header.loadAddrLo;
+    int endAddr = (header.endAddrHi << 8) | header.endAddrLo;
+    runAddr = loadAddr;
+    intFileName = nullptr;
+    bodySize = endAddr - loadAddr + 1;
+    return endAddr >= loadAddr;
+}
+
+
+inline bool parseHeader(const BruHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    loadAddr = (header.loadAddrHi << 8) | header.loadAddrLo;
+    runAddr = loadAddr;
+    intFileName = header.name;
+    bodySize = (header.lenHi << 8) | header.lenLo;
+    return bodySize != 0 && header.ff[0] == 0xFF && header.ff[1] == 0xFF && header.ff[2] == 0xFF;
+}
+
+
+inline bool parseHeader(const RkoHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    if (header.syncByte != 0xE6)
+        return false;
+    return parseHeader(header.bruHeader, loadAddr, runAddr, intFileName, bodySize);
+}
+
+
+inline bool parseHeader(const CasHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    if (memcmp(header.casSignature1, casSignature, sizeof(casSignature)) || memcmp(header.casSignature2, casSignature, sizeof(casSignature)))
+        return false;
+    loadAddr = (header.loadAddrHi << 8) | header.loadAddrLo;
+    int endAddr = (header.endAddrHi << 8) | header.endAddrLo;
+    runAddr = (header.runAddrHi << 8) | header.runAddrLo;
+    intFileName = header.name;
+    bodySize = endAddr - loadAddr + 1;
+    return endAddr >= loadAddr;
+}
+
+
+inline bool parseHeader(const LvtHeader& header, uint16_t& loadAddr, uint16_t& runAddr, const uint8_t*& intFileName, size_t& bodySize)
+{
+    if (memcmp(header.lvtSignature, lvtSignature, sizeof(lvtSignature)))
+        return false;
+    loadAddr = (header.loadAddrHi << 8) | header.loadAddrLo;
+    int endAddr = (header.endAddrHi << 8) | header.endAddrLo;
+    runAddr = (header.runAddrHi << 8) | header.runAddrLo;
+    intFileName = header.name;
+    bodySize = endAddr - loadAddr + 1;
+    return endAddr >= loadAddr;
+}
+
+
+// footer parsing, return false if the footer doesn't look valid
+
+inline bool parseFooter(const RkFooter& footer, uint16_t& cs)
+{
+    cs = (footer.csHi << 8) | footer.csLo;
+    return footer.nullByte1 == 0 && footer.nullByte2 == 0 && footer.syncByte == 0xE6;
+}
+
+
+inline bool parseFooter(const RkpFooter& footer, uint16_t& cs)
+{
+    cs = (footer.csHi << 8) | footer.csLo;
+    return footer.nullByte == 0 && footer.syncByte == 0xE6;
+}
+
+
+inline bool parseFooter(const Rk4Footer& footer, uint16_t& cs)
+{
+    cs = (footer.csHi1 << 8) | footer.csLo1;
+    for (uint8_t b: footer.nullBytes)
+        if (b)
+            return false;
+    return footer.syncByte == 0xE6 && footer.csHi1 == footer.csHi2 && footer.csLo1 == footer.csLo2;
+}
+
+
+inline bool parseFooter(const RkmFooter& footer, uint16_t& cs)
+{
+    cs = (footer.csHi << 8) | footer.csLo;
+    return true;
+}
+
+
+inline bool parseFooter(const RksFooter& footer, uint16_t& cs)
+{
+    cs = (footer.csHi << 8) | footer.csLo;
+    return true;
+}
+
+
+inline bool parseFooter(const RkoFooter& footer, uint16_t& cs)
+{
+    // padding may be shorter than in the struct, don't check it
+    cs = (footer.csHi << 8) | footer.csLo;
+    return footer.syncByte == 0xE6;
+}
+
+
+inline bool parseFooter(const NoFooter& /*footer*/, uint16_t& cs)
+{
+    cs = 0;
+    return true;
+}
+
+
+// checksums
+
+template <typename Header>
+inline uint16_t calcTapeCs(ChecksumType csType, const Header& /*header*/, const uint8_t* body, size_t bodySize, BodyChecksums& checksums)
+{
+    return csType == CST_NONE ? 0 : getBodyCs(body, bodySize, csType, checksums);
+}
+
+
+inline uint16_t calcTapeCs(ChecksumType /*csType*/, const RkoHeader& header, const uint8_t* body, size_t bodySize, BodyChecksums& /*checksums*/)
+{
+    static const uint8_t padding[3] = {0, 0, 0};
+
+    uint16_t cs = addToRkCs(0, reinterpret_cast<const uint8_t*>(&header.bruHeader), sizeof(BruHeader), false);
+    cs = addToRkCs(cs, body, bodySize, false);
+    cs = addToRkCs(cs, padding, 3, true);
+    return cs;
+}
+
+#endif // TAPEFORMAT_H
@@ -0,0 +1,43 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <iomanip>
+
+#include "tapeindex.h"
+#include "tapedecoder.h"
+
+
+using namespace std;
+
+
+void writeTapeIndexHeader(ostream& stream)
+{
+    stream << "# n offset size format load end run name file" << endl;
+}
+
+
+void writeTapeIndexEntry(ostream& stream, int n, const TapeIndexEntry& entry)
+{
+    stream << dec << n << " " << entry.offset << " " << entry.size << " " << getFormatExt(entry.format) << " "
+           << hex << uppercase << setfill('0')
+           << setw(4) << entry.loadAddr << " " << setw(4) << entry.endAddr << " " << setw(4) << entry.runAddr << " "
+           << "\"" << entry.intFileName << "\" " << entry.fileName << dec << endl;
+}
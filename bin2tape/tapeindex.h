@@ -0,0 +1,50 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEINDEX_H
+#define TAPEINDEX_H
+
+#include <ostream>
+#include <string>
+
+#include "bin2tape.h"
+
+
+// Index of programs in a multi-program tape stream, one text line per program:
+// number, offset and size (decimal), format, load, end and run address (hex),
+// internal name in quotes and file name (may be empty)
+
+struct TapeIndexEntry {
+    uint64_t offset;
+    size_t size;
+    TapeFileFormat format;
+    uint16_t loadAddr;
+    uint16_t endAddr;
+    uint16_t runAddr;
+    std::string intFileName;
+    std::string fileName;
+};
+
+
+void writeTapeIndexHeader(std::ostream& stream);
+void writeTapeIndexEntry(std::ostream& stream, int n, const TapeIndexEntry& entry);
+
+#endif // TAPEINDEX_H
@@ -0,0 +1,277 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <algorithm>
+
+#include "tapepack.h"
+
+
+using namespace std;
+
+
+static const size_t c_minMatch = 4;
+static const size_t c_maxMatch = 0x7F + c_minMatch;
+static const size_t c_maxLiterals = 0x7F;
+static const size_t c_maxDistance = 0xFFFF;
+static const int c_maxChain = 256;
+static const int c_hashBits = 14;
+
+
+// 8080 depacker, HL = packed data, DE = destination
+static const uint8_t c_stub[] = {
+    0x21, 0x00, 0x00,  //         LXI  H, src
+    0x11, 0x00, 0x00,  //         LXI  D, dst
+    0x7E,              // LOOP:   MOV  A, M
+    0x23,              //         INX  H
+    0xB7,              //         ORA  A
+    0xCA, 0x00, 0x00,  //         JZ   run
+    0xFA, 0x00, 0x00,  //         JM   MATCH
+    0x47,              //         MOV  B, A
+    0x7E,              // LIT:    MOV  A, M
+    0x12,              //         STAX D
+    0x23,              //         INX  H
+    0x13,              //         INX  D
+    0x05,              //         DCR  B
+    0xC2, 0x00, 0x00,  //         JNZ  LIT
+    0xC3, 0x00, 0x00,  //         JMP  LOOP
+    0xE6, 0x7F,        // MATCH:  ANI  7FH
+    0xC6, c_minMatch,  //         ADI  4
+    0x47,              //         MOV  B, A
+    0x4E,              //         MOV  C, M
+    0x23,              //         INX  H
+    0x7E,              //         MOV  A, M
+    0x23,              //         INX  H
+    0xE5,              //         PUSH H
+    0x67,              //         MOV  H, A
+    0x7B,              //         MOV  A, E
+    0x91,              //         SUB  C
+    0x6F,              //         MOV  L, A
+    0x7A,              //         MOV  A, D
+    0x9C,              //         SBB  H
+    0x67,              //         MOV  H, A
+    0x7E,              // COPY:   MOV  A, M
+    0x12,              //         STAX D
+    0x23,              //         INX  H
+    0x13,              //         INX  D
+    0x05,              //         DCR  B
+    0xC2, 0x00, 0x00,  //         JNZ  COPY
+    0xE1,              //         POP  H
+    0xC3, 0x00, 0x00   //         JMP  LOOP
+};
+
+// 8080 mover placed at the original load address: moves packed data and the depacker up
+// (backwards, the areas may overlap) and jumps to the depacker, so the program is started
+// from its load address even if the tape format has no run address
+static const uint8_t c_mover[] = {
+    0x21, 0x00, 0x00,  //         LXI  H, src end - 1
+    0x11, 0x00, 0x00,  //         LXI  D, dst end - 1
+    0x01, 0x00, 0x00,  //         LXI  B, len
+    0x7E,              // MOVE:   MOV  A, M
+    0x12,              //         STAX D
+    0x2B,              //         DCX  H
+    0x1B,              //         DCX  D
+    0x0B,              //         DCX  B
+    0x78,              //         MOV  A, B
+    0xB1,              //         ORA  C
+    0xC2, 0x00, 0x00,  //         JNZ  MOVE
+    0xC3, 0x00, 0x00   //         JMP  stub
+};
+
+static const int c_moverLoop = 9;
+
+static const int c_moverSrcOp = 1;
+static const int c_moverDstOp = 4;
+static const int c_moverLenOp = 7;
+static const int c_moverLoopOp = 17;
+static const int c_moverStubOp = 20;
+
+// offsets of labels and address operands in the stub
+static const int c_stubLoop = 6;
+static const int c_stubLit = 16;
+static const int c_stubMatch = 27;
+static const int c_stubCopy = 44;
+
+static const int c_stubSrcOp = 1;
+static const int c_stubDstOp = 4;
+static const int c_stubRunOp = 10;
+static const int c_stubMatchOp = 13;
+static const int c_stubLitOp = 22;
+static const int c_stubLoopOp1 = 25;
+static const int c_stubCopyOp = 50;
+static const int c_stubLoopOp2 = 54;
+
+
+static inline unsigned hash4(const uint8_t* p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+    return (v * 2654435761u) >> (32 - c_hashBits);
+}
+
+
+static void flushLiterals(const uint8_t* data, size_t start, size_t end, vector<uint8_t>& packed)
+{
+    while (start < end) {
+        size_t n = min(end - start, c_maxLiterals);
+        packed.push_back(uint8_t(n));
+        packed.insert(packed.end(), data + start, data + start + n);
+        start += n;
+    }
+}
+
+
+size_t lzPack(const uint8_t* data, size_t size, vector<uint8_t>& packed)
+{
+    packed.clear();
+
+    // hash chains of 4-byte sequences
+    vector<int> head(1 << c_hashBits, -1);
+    vector<int> prev(size, -1);
+
+    auto insert = [&](size_t pos) {
+        if (pos + c_minMatch <= size) {
+            unsigned h = hash4(data + pos);
+            prev[pos] = head[h];
+            head[h] = int(pos);
+        }
+    };
+
+    size_t litStart = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t bestLen = 0;
+        size_t bestDist = 0;
+
+        if (pos + c_minMatch <= size) {
+            size_t maxLen = min(c_maxMatch, size - pos);
+            int chain = c_maxChain;
+            for (int cand = head[hash4(data + pos)]; cand >= 0 && chain--; cand = prev[cand]) {
+                size_t dist = pos - cand;
+                if (dist > c_maxDistance)
+                    break;
+                size_t len = 0;
+                while (len < maxLen && data[cand + len] == data[pos + len])
+                    ++len;
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestDist = dist;
+                    if (len == maxLen)
+                        break;
+                }
+            }
+        }
+
+        if (bestLen < c_minMatch) {
+            insert(pos++);
+            continue;
+        }
+
+        flushLiterals(data, litStart, pos, packed);
+        packed.push_back(uint8_t(0x80 | (bestLen - c_minMatch)));
+        packed.push_back(bestDist & 0xFF);
+        packed.push_back(bestDist >> 8);
+
+        for (size_t i = 0; i < bestLen; i++)
+            insert(pos++);
+        litStart = pos;
+    }
+
+    flushLiterals(data, litStart, size, packed);
+    packed.push_back(0);
+
+    return packed.size();
+}
+
+
+// Returns how far the packed data must start above the destination so that unpacked
+// bytes never overwrite packed bytes which are not read yet
+static size_t getUnpackMargin(const vector<uint8_t>& packed)
+{
+    size_t src = 0;
+    size_t dst = 0;
+    size_t margin = 0;
+
+    while (packed[src]) {
+        uint8_t token = packed[src];
+        if (token & 0x80) {
+            src += 3;
+            dst += (token & 0x7F) + c_minMatch;
+        } else {
+            src += 1 + token;
+            dst += token;
+        }
+        if (dst > src)
+            margin = max(margin, dst - src);
+    }
+
+    return margin;
+}
+
+
+static void putAddr(vector<uint8_t>& body, size_t offset, unsigned addr)
+{
+    body[offset] = addr & 0xFF;
+    body[offset + 1] = (addr >> 8) & 0xFF;
+}
+
+
+bool makeSelfExtracting(const uint8_t* body, size_t bodySize, uint16_t loadAddr, uint16_t runAddr, PackedProgram& program)
+{
+    vector<uint8_t> packed;
+    lzPack(body, bodySize, packed);
+
+    // the margin also keeps the end of the packed data above the end of the program,
+    // so the stub placed after the packed data is never overwritten;
+    // packed data is loaded after the mover and is moved up by it, never down
+    size_t margin = max(getUnpackMargin(packed), sizeof(c_mover));
+    size_t src = loadAddr + margin;
+    size_t stub = src + packed.size();
+    if (stub + sizeof(c_stub) > 0x10000)
+        return false;
+
+    size_t moveSize = packed.size() + sizeof(c_stub);
+    size_t loadedSrc = loadAddr + sizeof(c_mover);
+
+    program.body.assign(c_mover, c_mover + sizeof(c_mover));
+    putAddr(program.body, c_moverSrcOp, loadedSrc + moveSize - 1);
+    putAddr(program.body, c_moverDstOp, src + moveSize - 1);
+    putAddr(program.body, c_moverLenOp, moveSize);
+    putAddr(program.body, c_moverLoopOp, loadAddr + c_moverLoop);
+    putAddr(program.body, c_moverStubOp, stub);
+
+    program.body.insert(program.body.end(), packed.begin(), packed.end());
+    program.packedSize = packed.size();
+    program.loadAddr = loadAddr;
+    program.runAddr = loadAddr;
+
+    size_t base = program.body.size();
+    program.body.insert(program.body.end(), c_stub, c_stub + sizeof(c_stub));
+
+    putAddr(program.body, base + c_stubSrcOp, src);
+    putAddr(program.body, base + c_stubDstOp, loadAddr);
+    putAddr(program.body, base + c_stubRunOp, runAddr);
+    putAddr(program.body, base + c_stubMatchOp, stub + c_stubMatch);
+    putAddr(program.body, base + c_stubLitOp, stub + c_stubLit);
+    putAddr(program.body, base + c_stubLoopOp1, stub + c_stubLoop);
+    putAddr(program.body, base + c_stubCopyOp, stub + c_stubCopy);
+    putAddr(program.body, base + c_stubLoopOp2, stub + c_stubLoop);
+
+    return true;
+}
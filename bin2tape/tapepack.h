@@ -0,0 +1,52 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEPACK_H
+#define TAPEPACK_H
+
+#include <cstddef>
+#include <vector>
+
+#include "bin2tape.h"
+
+
+// Self-extracting program: 8080 mover, LZ packed body and the depacker stub. The program is
+// loaded and started at the original load address, the mover moves packed data and the stub
+// high enough not to be overwritten while unpacking, the stub unpacks the body to the original
+// load address and jumps to the original run address.
+struct PackedProgram {
+    std::vector<uint8_t> body;  // mover, packed data and the stub
+    uint16_t loadAddr;          // original load address
+    uint16_t runAddr;           // mover address, equals loadAddr
+    size_t packedSize;          // size of the packed data w/o the mover and the stub
+};
+
+
+// Packed stream format:
+//   00               - end of data
+//   01..7F, bytes    - literal bytes
+//   80..FF, lo, hi   - match of (token & 7F) + 4 bytes at the given distance back
+size_t lzPack(const uint8_t* data, size_t size, std::vector<uint8_t>& packed);
+
+// Returns false if the program with the stub doesn't fit into memory
+bool makeSelfExtracting(const uint8_t* body, size_t bodySize, uint16_t loadAddr, uint16_t runAddr, PackedProgram& program);
+
+#endif // TAPEPACK_H
@@ -0,0 +1,159 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <cstddef>
+#include <cstring>
+
+#include "tapescanner.h"
+
+
+using namespace std;
+
+
+// bytes which may start an image: CAS signature, LVT signature, RK/RKO sync byte
+static const uint8_t c_candidateBytes[3] = {casSignature[0], lvtSignature[0], 0xE6};
+
+// RKO sync byte offset from the image start
+static const size_t c_rkoSyncOffset = offsetof(RkoHeader, syncByte);
+
+// bytes kept before the scan position when the buffer is shifted (for RKO header)
+static const size_t c_history = c_rkoSyncOffset;
+
+
+TapeScanner::TapeScanner(istream& stream) : m_stream(stream)
+{
+    m_buf.resize(c_bufSize);
+}
+
+
+uint64_t TapeScanner::getBytesScanned()
+{
+    return m_bufOffset + m_pos;
+}
+
+
+void TapeScanner::fillBuffer()
+{
+    // shift the unscanned tail (and a bit of history) to the buffer start
+    size_t keepFrom = m_pos > c_history ? m_pos - c_history : 0;
+    if (keepFrom) {
+        memmove(m_buf.data(), m_buf.data() + keepFrom, m_filled - keepFrom);
+        m_filled -= keepFrom;
+        m_pos -= keepFrom;
+        m_minStart = m_minStart > keepFrom ? m_minStart - keepFrom : 0;
+        m_bufOffset += keepFrom;
+    }
+
+    while (!m_eof && m_filled < c_bufSize) {
+        m_stream.read(reinterpret_cast<char*>(m_buf.data() + m_filled), c_bufSize - m_filled);
+        m_filled += m_stream.gcount();
+        if (!m_stream)
+            m_eof = true;
+    }
+
+    for (const uint8_t*& next: m_next)
+        next = nullptr;
+}
+
+
+size_t TapeScanner::findCandidate()
+{
+    // memchr is vectorized in all common C libraries, search for each byte separately
+    // and cache the results until the scan position passes them
+    const uint8_t* start = m_buf.data() + m_pos;
+    const uint8_t* end = m_buf.data() + m_filled;
+
+    const uint8_t* nearest = end;
+    for (int i = 0; i < 3; i++) {
+        if (!m_next[i] || m_next[i] < start) {
+            m_next[i] = static_cast<const uint8_t*>(memchr(start, c_candidateBytes[i], end - start));
+            if (!m_next[i])
+                m_next[i] = end;
+        }
+        if (m_next[i] < nearest)
+            nearest = m_next[i];
+    }
+
+    return nearest - m_buf.data();
+}
+
+
+bool TapeScanner::tryDecode(size_t pos, TapeImageInfo& info)
+{
+    const uint8_t* data = m_buf.data();
+    size_t size = m_filled;
+
+    if (data[pos] == casSignature[0] || data[pos] == lvtSignature[0]) {
+        TapeFileFormat format = data[pos] == casSignature[0] ? TFF_CAS : TFF_LVT;
+        if (decodeTapeFormat(data + pos, size - pos, format, info) != TDR_OK)
+            return false;
+        info.imageOffset = pos;
+        return true;
+    }
+
+    // sync byte: RKO image containing it or RK image following it
+    if (pos >= m_minStart + c_rkoSyncOffset) {
+        size_t start = pos - c_rkoSyncOffset;
+        if (decodeTapeFormat(data + start, size - start, TFF_RKO, info) == TDR_OK) {
+            info.imageOffset = start;
+            return true;
+        }
+    }
+
+    // only images with matching checksums are accepted, RKS is the last as it has no header signature at all
+    static const TapeFileFormat rkFormats[] = {TFF_RK4, TFF_RK, TFF_RKU, TFF_RKP, TFF_RKM, TFF_RKS};
+    for (TapeFileFormat format: rkFormats)
+        if (decodeTapeFormat(data + pos + 1, size - pos - 1, format, info) == TDR_OK) {
+            info.imageOffset = pos + 1;
+            return true;
+        }
+
+    return false;
+}
+
+
+bool TapeScanner::findNext(TapeImageInfo& info, uint64_t& offset, const uint8_t*& image)
+{
+    for (;;) {
+        size_t pos = findCandidate();
+
+        if (pos == m_filled && m_eof) {
+            m_pos = m_filled;
+            return false;
+        }
+
+        // make sure a whole image may follow the candidate
+        if (!m_eof && m_filled - pos < c_maxImageSize) {
+            m_pos = pos;
+            fillBuffer();
+            continue;
+        }
+
+        if (tryDecode(pos, info)) {
+            offset = m_bufOffset + info.imageOffset;
+            image = m_buf.data() + info.imageOffset;
+            m_pos = m_minStart = info.imageOffset + info.imageSize;
+            return true;
+        }
+
+        m_pos = pos + 1;
+    }
+}
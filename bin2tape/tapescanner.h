@@ -0,0 +1,66 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPESCANNER_H
+#define TAPESCANNER_H
+
+#include <istream>
+#include <vector>
+
+#include "tapedecoder.h"
+
+
+// Finds tape images (CAS, LVT, RKO and E6-synced RK, RKM and RKS blocks with valid checksums)
+// in an arbitrarily long stream of concatenated programs or raw tape dumps.
+// The stream is read through a fixed size window, so memory usage doesn't depend
+// on the stream size.
+class TapeScanner
+{
+public:
+    TapeScanner(std::istream& stream);
+
+    // Returns false at the end of stream. On success info.body and image point into
+    // the internal buffer and stay valid until the next call.
+    bool findNext(TapeImageInfo& info, uint64_t& offset, const uint8_t*& image);
+
+    uint64_t getBytesScanned();
+
+private:
+    static const size_t c_maxImageSize = 0x10000 + 0x100;
+    static const size_t c_bufSize = c_maxImageSize * 4;
+
+    std::istream& m_stream;
+    std::vector<uint8_t> m_buf;
+    size_t m_pos = 0;          // current scan position in the buffer
+    size_t m_filled = 0;       // number of valid bytes in the buffer
+    size_t m_minStart = 0;     // end of the last found image, next one can't start before it
+    uint64_t m_bufOffset = 0;  // stream offset of the buffer start
+    bool m_eof = false;
+
+    // cached positions of the next candidate bytes, see findCandidate()
+    const uint8_t* m_next[3] = {nullptr, nullptr, nullptr};
+
+    void fillBuffer();
+    size_t findCandidate();
+    bool tryDecode(size_t pos, TapeImageInfo& info);
+};
+
+#endif // TAPESCANNER_H
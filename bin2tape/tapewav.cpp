@@ -0,0 +1,327 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <vector>
+#include <cstring>
+
+#include "tapewav.h"
+
+
+using namespace std;
+
+
+enum TapeEncoding {
+    TE_BIPHASE,  // RK86 family: each bit is two half-periods, inverted bit value then bit value, MSB first
+    TE_FSK,      // MSX compatible: 0 = one 1200 Hz period, 1 = two 2400 Hz periods, start bit, LSB first, 2 stop bits
+    TE_NONE
+};
+
+
+struct TapeAudioFormat {
+    TapeEncoding encoding;
+    unsigned bitRate;     // bits per second at normal speed
+    unsigned pilotBits;   // pilot tone before each block: 00 bytes for TE_BIPHASE, 1 bits for TE_FSK
+};
+
+
+// indexed by TapeFileFormat
+static const TapeAudioFormat c_audioFormats[] = {
+    {TE_BIPHASE, 1200, 256 * 8},  // RK
+    {TE_BIPHASE, 1200, 256 * 8},  // RKP
+    {TE_BIPHASE, 1200, 256 * 8},  // RKM
+    {TE_BIPHASE, 1200, 256 * 8},  // RKU
+    {TE_BIPHASE, 1200, 256 * 8},  // RK4
+    {TE_BIPHASE, 1200, 256 * 8},  // RKS
+    {TE_BIPHASE, 1200, 256 * 8},  // RKO
+    {TE_NONE,       0,       0},  // BRU
+    {TE_FSK,     1200,    4000},  // CAS
+    {TE_FSK,     1200,    4000}   // LVT
+};
+
+static_assert(sizeof(c_audioFormats) / sizeof(c_audioFormats[0]) == TFF_LVT + 1, "Format table mismatch!");
+
+
+static const uint8_t c_syncByte = 0xE6;
+
+static const unsigned c_shortPilotBits = 1000;  // FSK header before the second and following CAS blocks
+static const double c_leadInTime = 0.5;         // silence at the start and at the end, seconds
+static const double c_blockGapTime = 1.0;       // silence between CAS blocks, seconds
+
+static const size_t c_blockSize = 0x10000;      // output block size, bytes
+
+static const unsigned c_minHalfPeriod = 2;      // shortest half-period, samples
+
+
+// Precomputed waveforms of a 0 and 1 bit as little-endian 16-bit samples
+class BitTables
+{
+public:
+    BitTables(TapeEncoding encoding, unsigned bitRate, const WavParams& params);
+
+    const vector<uint8_t>& operator[](int bit) const {return m_bits[bit];}
+
+private:
+    vector<uint8_t> m_bits[2];
+    int16_t m_level;
+
+    void addHalfPeriods(vector<uint8_t>& table, double halfPeriod, int nHalfPeriods, bool startHigh);
+};
+
+
+BitTables::BitTables(TapeEncoding encoding, unsigned bitRate, const WavParams& params)
+{
+    m_level = int16_t(32767 * params.amplitude / 100);
+    // in turbo mode all pulses are shortened proportionally: RK86 compatible loaders measure
+    // the pulse width on the pilot tone and MSX BIOS detects the speed on the header tone
+    double bitLen = double(params.sampleRate) / (bitRate * params.speed);
+
+    if (encoding == TE_BIPHASE) {
+        addHalfPeriods(m_bits[0], bitLen / 2, 2, true);
+        addHalfPeriods(m_bits[1], bitLen / 2, 2, false);
+    } else {
+        addHalfPeriods(m_bits[0], bitLen / 2, 2, true);
+        addHalfPeriods(m_bits[1], bitLen / 4, 4, true);
+    }
+}
+
+
+void BitTables::addHalfPeriods(vector<uint8_t>& table, double halfPeriod, int nHalfPeriods, bool startHigh)
+{
+    unsigned len = unsigned(halfPeriod + 0.5);
+    if (!len)
+        len = 1;
+
+    for (int i = 0; i < nHalfPeriods; i++) {
+        int16_t sample = (i % 2 == 0) == startHigh ? m_level : -m_level;
+        for (unsigned j = 0; j < len; j++) {
+            table.push_back(uint16_t(sample) & 0xFF);
+            table.push_back(uint16_t(sample) >> 8);
+        }
+    }
+}
+
+
+bool checkWavParams(TapeFileFormat format, const WavParams& params, string& error)
+{
+    const TapeAudioFormat& audioFormat = c_audioFormats[format];
+    if (audioFormat.encoding == TE_NONE)
+        return true;
+
+    // MSX BIOS detects 1200 and 2400 baud only
+    if (audioFormat.encoding == TE_FSK && params.speed != 1 && params.speed != 2) {
+        error = "Speed factor for cas and lvt must be 1 or 2!";
+        return false;
+    }
+
+    // the shortest half-period is a half of a bit for TE_BIPHASE and a quarter of a 1 bit for TE_FSK
+    double bitLen = double(params.sampleRate) / (audioFormat.bitRate * params.speed);
+    double halfPeriod = audioFormat.encoding == TE_BIPHASE ? bitLen / 2 : bitLen / 4;
+    if (unsigned(halfPeriod + 0.5) < c_minHalfPeriod) {
+        error = "Sample rate is too low for this speed factor!";
+        return false;
+    }
+
+    return true;
+}
+
+
+// Counts samples, used to fill in the WAV header before rendering and to estimate duration
+class SampleCounter
+{
+public:
+    void put(const vector<uint8_t>& samples) {m_bytes += samples.size();}
+    void putSilence(size_t nSamples) {m_bytes += nSamples * 2;}
+
+    uint64_t getBytes() {return m_bytes;}
+
+private:
+    uint64_t m_bytes = 0;
+};
+
+
+// Collects samples into fixed size blocks and writes them to the stream
+class BlockWriter
+{
+public:
+    BlockWriter(ostream& out) : m_out(out) {m_buf.reserve(c_blockSize);}
+
+    void put(const vector<uint8_t>& samples);
+    void putSilence(size_t nSamples);
+    bool flush();
+
+private:
+    ostream& m_out;
+    vector<uint8_t> m_buf;
+};
+
+
+void BlockWriter::put(const vector<uint8_t>& samples)
+{
+    if (m_buf.size() + samples.size() > c_blockSize)
+        flush();
+    m_buf.insert(m_buf.end(), samples.begin(), samples.end());
+}
+
+
+void BlockWriter::putSilence(size_t nSamples)
+{
+    while (nSamples) {
+        if (m_buf.size() == c_blockSize)
+            flush();
+        size_t n = min(nSamples, (c_blockSize - m_buf.size()) / 2);
+        m_buf.insert(m_buf.end(), n * 2, 0);
+        nSamples -= n;
+    }
+}
+
+
+bool BlockWriter::flush()
+{
+    m_out.write((const char*)m_buf.data(), m_buf.size());
+    m_buf.clear();
+    return !m_out.fail();
+}
+
+
+template <class Sink>
+static void putBiphaseByte(Sink& sink, const BitTables& bits, uint8_t byte)
+{
+    for (int i = 7; i >= 0; i--)
+        sink.put(bits[(byte >> i) & 1]);
+}
+
+
+template <class Sink>
+static void putFskByte(Sink& sink, const BitTables& bits, uint8_t byte)
+{
+    sink.put(bits[0]);
+    for (int i = 0; i < 8; i++)
+        sink.put(bits[(byte >> i) & 1]);
+    sink.put(bits[1]);
+    sink.put(bits[1]);
+}
+
+
+template <class Sink>
+static void renderTape(Sink& sink, const uint8_t* image, size_t imageSize, TapeFileFormat format, const WavParams& params)
+{
+    const TapeAudioFormat& audioFormat = c_audioFormats[format];
+    BitTables bits(audioFormat.encoding, audioFormat.bitRate, params);
+
+    size_t leadIn = size_t(params.sampleRate * c_leadInTime);
+    sink.putSilence(leadIn);
+
+    if (audioFormat.encoding == TE_BIPHASE) {
+        // pilot, sync byte and the image (RKO contains the second pilot and sync byte itself)
+        for (unsigned i = 0; i < audioFormat.pilotBits; i++)
+            sink.put(bits[0]);
+        putBiphaseByte(sink, bits, c_syncByte);
+        for (size_t i = 0; i < imageSize; i++)
+            putBiphaseByte(sink, bits, image[i]);
+    } else {
+        // CAS signatures at 8-byte boundaries and the LVT signature are replaced with the header tone
+        size_t i = 0;
+        unsigned pilotBits = audioFormat.pilotBits;
+        if (format == TFF_LVT) {
+            i = sizeof(lvtSignature);
+            for (unsigned j = 0; j < pilotBits; j++)
+                sink.put(bits[1]);
+        }
+        for (; i < imageSize; i++) {
+            if (format == TFF_CAS && i % 8 == 0 && i + 8 <= imageSize && !memcmp(image + i, casSignature, 8)) {
+                if (i) {
+                    sink.putSilence(size_t(params.sampleRate * c_blockGapTime));
+                    pilotBits = c_shortPilotBits;
+                }
+                for (unsigned j = 0; j < pilotBits; j++)
+                    sink.put(bits[1]);
+                i += 7;
+                continue;
+            }
+            putFskByte(sink, bits, image[i]);
+        }
+    }
+
+    sink.putSilence(leadIn);
+}
+
+
+static void putLe(uint8_t*& p, uint32_t value, int nBytes)
+{
+    for (int i = 0; i < nBytes; i++) {
+        *p++ = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+
+bool isWavSupported(TapeFileFormat format)
+{
+    return c_audioFormats[format].encoding != TE_NONE;
+}
+
+
+bool writeTapeWav(const uint8_t* image, size_t imageSize, TapeFileFormat format, const WavParams& params, ostream& out)
+{
+    if (!isWavSupported(format))
+        return false;
+
+    // the data size is calculated in advance, so output stream may be a pipe
+    SampleCounter counter;
+    renderTape(counter, image, imageSize, format, params);
+    uint32_t dataSize = uint32_t(counter.getBytes());
+
+    uint8_t header[44];
+    uint8_t* p = header;
+    memcpy(p, "RIFF", 4);
+    p += 4;
+    putLe(p, 36 + dataSize, 4);
+    memcpy(p, "WAVEfmt ", 8);
+    p += 8;
+    putLe(p, 16, 4);                      // fmt chunk size
+    putLe(p, 1, 2);                       // PCM
+    putLe(p, 1, 2);                       // mono
+    putLe(p, params.sampleRate, 4);
+    putLe(p, params.sampleRate * 2, 4);   // byte rate
+    putLe(p, 2, 2);                       // block align
+    putLe(p, 16, 2);                      // bits per sample
+    memcpy(p, "data", 4);
+    p += 4;
+    putLe(p, dataSize, 4);
+
+    out.write((const char*)header, sizeof(header));
+
+    BlockWriter writer(out);
+    renderTape(writer, image, imageSize, format, params);
+
+    return writer.flush();
+}
+
+
+double getTapeWavDuration(const uint8_t* image, size_t imageSize, TapeFileFormat format, const WavParams& params)
+{
+    if (!isWavSupported(format))
+        return 0;
+
+    SampleCounter counter;
+    renderTape(counter, image, imageSize, format, params);
+    return double(counter.getBytes() / 2) / params.sampleRate;
+}
@@ -0,0 +1,49 @@
+/*
+ *  bin2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2021-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEWAV_H
+#define TAPEWAV_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include "bin2tape.h"
+
+
+// Tape image to audio renderer. Output is a mono 16-bit PCM WAV stream written
+// in fixed size blocks, so memory usage doesn't depend on the image size.
+// Functions are reentrant and may be called from several threads at once.
+
+// BRU is a disk image format and can't be rendered
+bool isWavSupported(TapeFileFormat format);
+
+// Checks that the sample rate and speed give pulse widths the loaders can tell apart
+// and that the speed is supported by the format, error receives the reason
+bool checkWavParams(TapeFileFormat format, const WavParams& params, std::string& error);
+
+// Returns false on write error. The stream doesn't have to be seekable.
+bool writeTapeWav(const uint8_t* image, size_t imageSize, TapeFileFormat format, const WavParams& params, std::ostream& out);
+
+// Returns duration of the rendered audio in seconds (load time including pilot tone and pauses)
+double getTapeWavDuration(const uint8_t* image, size_t imageSize, TapeFileFormat format, const WavParams& params);
+
+#endif // TAPEWAV_H
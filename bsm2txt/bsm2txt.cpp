@@ -0,0 +1,414 @@
+/*
+ *  bsm2txt v. 2.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2016-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "bsmcodec.h"
+#include "../bin2tape/tapedecoder.h"
+#include "../rkdisk/rkimage/rkvolume.h"
+#include "../common/threadpool.h"
+#include "../common/outputnames.h"
+
+#define VERSION "2.01"
+
+
+using namespace std;
+
+
+// standard output saved before messages are redirected to stderr (see main)
+static streambuf* const stdoutBuf = cout.rdbuf();
+
+
+void usage(string& moduleName)
+{
+            cout << "Usage: " << moduleName << " [options] file.bsm|tape_file|image.rdi|directory..." << endl << endl <<
+            "Converts tokenized BASIC programs to text files file.txt. Programs are read from" << endl <<
+            "bsm files, from tape images (rk*, rks, rko, bru/ord, cas, lvt) and from all files" << endl <<
+            "of RK DOS disk images (image_FILE.EXT.txt is written for each BASIC program found)." << endl << endl <<
+            "options are:" << endl << endl <<
+            "  -o directory" << endl <<
+            "    output directory for text files, default is current directory;" << endl <<
+            "    \"-o -\" writes all listings to standard output" << endl << endl <<
+            "  -u" << endl <<
+            "    UTF-8 output, default is DOS encoding (cp866)" << endl << endl <<
+            "  -d dialect" << endl <<
+            "    BASIC dialect: micron (Basic Micron, default), rk86 (Radio-86RK BASIC) or msx" << endl <<
+            "    (MSX BASIC); cas files of tokenized BASIC type (D3h) are always MSX BASIC" << endl << endl <<
+            "  -j threads" << endl <<
+            "    number of worker threads, default = number of CPU cores" << endl << endl <<
+            "Directories are scanned for .bsm, tape image and .rdi files. Listing is named" << endl <<
+            "<name>.txt, or <name>.<ext>.txt if several input files have the same name." << endl;
+}
+
+
+// Reads the whole file with a single block read
+bool loadFile(const string& fileName, vector<uint8_t>& data)
+{
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail())
+        return false;
+
+    f.seekg(0, ios_base::end);
+    int size = f.tellg();
+    f.seekg(0, ios_base::beg);
+
+    data.resize(size);
+    f.read((char*)(data.data()), size);
+    if (f.fail())
+        return false;
+
+    f.close();
+
+    return true;
+}
+
+
+string getFileExt(const string& fileName)
+{
+    size_t periodPos = fileName.find_last_of('.');
+    size_t slashPos = fileName.find_last_of("/\\:");
+    if (periodPos == string::npos || (slashPos != string::npos && periodPos < slashPos))
+        return "";
+    return fileName.substr(periodPos + 1);
+}
+
+
+void addInputFiles(const string& name, vector<string>& fileNames)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) || !S_ISDIR(st.st_mode)) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    DIR* dir = opendir(name.c_str());
+    if (!dir) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    vector<string> dirFiles;
+    while (dirent* entry = readdir(dir)) {
+        string fileName = entry->d_name;
+        string ext = getFileExt(fileName);
+        transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        TapeFileFormat format;
+        if (ext == "bsm" || ext == "rdi" || getFormatsByExt(ext, &format))
+            dirFiles.push_back(name + "/" + fileName);
+    }
+    closedir(dir);
+
+    sort(dirFiles.begin(), dirFiles.end());
+    fileNames.insert(fileNames.end(), dirFiles.begin(), dirFiles.end());
+}
+
+
+// Writes a listing to fileName or appends it to text if outputDir is "-"
+bool writeListing(const string& fileName, const string& listing, const string& outputDir, string& text, ostream& log)
+{
+    log << count(listing.begin(), listing.end(), '\n') << " line(s)";
+
+    if (outputDir == "-") {
+        text.append(listing);
+        return true;
+    }
+
+    ofstream f(fileName);
+    f.write(listing.data(), listing.size());
+    f.close();
+    if (f.fail()) {
+        log << ", error writing " << fileName << "!";
+        return false;
+    }
+    log << " -> " << fileName;
+
+    return true;
+}
+
+
+// Finds the program of an MSX cas file of tokenized BASIC type: a header block of 10 D3h bytes and the name,
+// then a data block with the program as it's stored in memory. Blocks start with casSignature at 8 byte boundaries.
+bool findCasBasicProgram(const uint8_t* data, size_t size, const uint8_t*& program, size_t& programSize)
+{
+    const size_t c_headerSize = sizeof(casSignature) + 10 + 6;
+
+    if (size < c_headerSize || memcmp(data, casSignature, sizeof(casSignature)))
+        return false;
+    for (size_t i = sizeof(casSignature); i < sizeof(casSignature) + 10; i++)
+        if (data[i] != 0xD3)
+            return false;
+
+    size_t pos = (c_headerSize + 7) & ~size_t(7);
+    while (pos + sizeof(casSignature) <= size && memcmp(data + pos, casSignature, sizeof(casSignature)))
+        pos += 8;
+    if (pos + sizeof(casSignature) > size)
+        return false;
+    pos += sizeof(casSignature);
+
+    // the data block lasts up to the next block or the end of file
+    size_t end = pos;
+    while (end + sizeof(casSignature) <= size && memcmp(data + end, casSignature, sizeof(casSignature)))
+        end += 8;
+    if (end + sizeof(casSignature) > size)
+        end = size;
+
+    program = data + pos;
+    programSize = end - pos;
+    return true;
+}
+
+
+// Converts all BASIC programs in an RK DOS image
+bool processDiskImage(const string& fileName, const string& baseName, const string& outputDir, BasicDialect dialect,
+                      TextEncoding encoding, string& text, ostream& log)
+{
+    log << "RK DOS image" << endl;
+
+    bool ok = true;
+    int nPrograms = 0;
+
+    try {
+        RkVolume vol(fileName, IFM_READ_ONLY);
+
+        for (const RkFileInfo& fi: *vol.getFileList()) {
+            int size = 0;
+            uint8_t* data = vol.readFile(fi.fileName, size);
+
+            string listing;
+            DetokenizeResult res = detokenizeProgram(data, size, dialect, encoding, listing);
+            delete[] data;
+
+            if (res == DR_NOT_BASIC)
+                continue;
+
+            ++nPrograms;
+            log << "\t" << fi.fileName << ": ";
+            if (!writeListing(baseName + "_" + fi.fileName + ".txt", listing, outputDir, text, log))
+                ok = false;
+            if (res == DR_TRUNCATED) {
+                log << ", unexpected end of file!";
+                ok = false;
+            }
+            log << endl;
+        }
+    }
+
+    catch (RkVolume::RkVolumeException&) {
+        log << "\tbad disk image!" << endl;
+        return false;
+    }
+
+    catch (ImageFileException&) {
+        log << "\tfile read error!" << endl;
+        return false;
+    }
+
+    log << "\t" << nPrograms << " BASIC program(s) found" << endl;
+
+    return ok && nPrograms;
+}
+
+
+// Converts a file, the listing is written to <baseName>.txt (baseName includes output directory) or returned in text if outputDir is "-"
+bool processFile(const string& fileName, const string& baseName, const string& outputDir, BasicDialect dialect, TextEncoding encoding,
+                 string& text, ostream& log)
+{
+    log << fileName << ": ";
+
+    string ext = getFileExt(fileName);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == "rdi")
+        return processDiskImage(fileName, baseName, outputDir, dialect, encoding, text, log);
+
+    vector<uint8_t> data;
+    if (!loadFile(fileName, data)) {
+        log << "file read error!" << endl;
+        return false;
+    }
+
+    string listing;
+    DetokenizeResult res;
+
+    const uint8_t* program;
+    size_t programSize;
+
+    TapeFileFormat preferredFormat;
+    int nPreferredFormats = getFormatsByExt(ext, &preferredFormat);
+    if (ext == "cas" && findCasBasicProgram(data.data(), data.size(), program, programSize)) {
+        log << "MSX BASIC cas, ";
+        res = detokenizeProgram(program, programSize, BD_MSX, encoding, listing);
+        if (res == DR_NOT_BASIC) {
+            log << "bad program!" << endl;
+            return false;
+        }
+    } else if (nPreferredFormats) {
+        // program text is the body of the tape image
+        TapeImageInfo info;
+        TapeDecodeResult tapeRes = decodeTape(data.data(), data.size(), info, &preferredFormat, nPreferredFormats);
+        if (tapeRes == TDR_UNKNOWN_FORMAT) {
+            log << "unknown tape format!" << endl;
+            return false;
+        }
+        log << txtFormats[info.format] << (tapeRes == TDR_BAD_CHECKSUM ? " (checksum error), " : ", ");
+
+        res = detokenizeProgram(info.body, info.bodySize, dialect, encoding, listing);
+        if (res == DR_NOT_BASIC) {
+            log << "not a BASIC program!" << endl;
+            return false;
+        }
+    } else
+        res = detokenizeBsm(data.data(), data.size(), dialect, encoding, listing) ? DR_OK : DR_TRUNCATED;
+
+    bool ok = writeListing(baseName + ".txt", listing, outputDir, text, log);
+    if (res == DR_TRUNCATED) {
+        log << ", unexpected end of file!";
+        ok = false;
+    }
+    log << endl;
+
+    return ok;
+}
+
+
+int main(int argc, const char** argv)
+{
+    string moduleName = argv[0];
+    moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
+
+    string outputDir;
+    TextEncoding encoding = TE_CP866;
+    BasicDialect dialect = BD_MICRON;
+    int nThreads = 0;
+    vector<string> fileNames;
+
+    // parse command line
+
+    int i = 1;
+    string option;
+    while (i < argc) {
+        option = argv[i];
+
+        if (option == "-o" || option == "-j" || option == "-d") {
+            ++i;
+            if (i >= argc) {
+                usage(moduleName);
+                return 1;
+            }
+            if (option == "-o")
+                outputDir = argv[i];
+            else if (option == "-d") {
+                if (!parseBasicDialect(argv[i], dialect)) {
+                    cout << "Invalid dialect: " << argv[i] << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            } else {
+                char* numEnd;
+                nThreads = strtoul(argv[i], &numEnd, 10);
+                if (*numEnd) {
+                    cout << "Invalid number of threads!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            }
+        } else if (option == "-u") {
+            encoding = TE_UTF8;
+        } else if (option[0] == '-') {
+            cout << "Invalid option:" << option << endl << endl;
+            usage(moduleName);
+            return 1;
+        } else
+            fileNames.push_back(option);
+
+        ++i;
+    }
+
+    // listings go to standard output, messages to stderr
+    if (outputDir == "-")
+        cout.rdbuf(cerr.rdbuf());
+
+    cout << "bsm2txt v. " VERSION " (c) Viktor Pykhonin, 2016-2026" << endl << endl;
+
+    if (argc < 2) {
+        usage(moduleName);
+        return 1;
+    }
+
+    // expand directories
+    vector<string> names;
+    names.swap(fileNames);
+    for (const string& name: names)
+        addInputFiles(name, fileNames);
+
+    if (fileNames.empty()) {
+        cout << "No input files!" << endl << endl;
+        usage(moduleName);
+        return 1;
+    }
+
+    vector<string> baseNames(fileNames.size());
+    if (outputDir != "-" && !makeOutputBaseNames(fileNames, outputDir, baseNames))
+        return 1;
+
+    mutex coutMutex;
+    vector<bool> results(fileNames.size());
+    vector<string> texts(fileNames.size());
+
+    runParallel(fileNames.size(), [&](int n) {
+        ostringstream log;
+        bool ok = processFile(fileNames[n], baseNames[n], outputDir, dialect, encoding, texts[n], log);
+
+        lock_guard<mutex> lock(coutMutex);
+        results[n] = ok;
+        cout << log.str();
+    }, nThreads);
+
+    // listings are written to standard output in the order of the input files
+    if (outputDir == "-") {
+        ostream out(stdoutBuf);
+        for (const string& text: texts)
+            out.write(text.data(), text.size());
+        out.flush();
+    }
+
+    int nErrors = 0;
+    for (bool ok: results)
+        if (!ok)
+            ++nErrors;
+
+    cout << endl << dec << fileNames.size() - nErrors << " of " << fileNames.size() << " file(s) OK";
+    if (nErrors)
+        cout << ", " << nErrors << " failed";
+    cout << "." << endl;
+
+    return nErrors ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    bsm2txt.cpp \
+    bsmcodec.cpp \
+    ../bin2tape/tapedecoder.cpp \
+    ../bin2tape/tapeencoder.cpp \
+    ../rkdisk/rkimage/imagefile.cpp \
+    ../rkdisk/rkimage/rkhashtree.cpp \
+    ../rkdisk/rkimage/rkvolume.cpp \
+    ../rkdisk/rkimage/trackcodec.cpp \
+    ../rkdisk/rkimage/volume.cpp
+
+HEADERS += \
+    bsmcodec.h \
+    ../bin2tape/tapedecoder.h \
+    ../bin2tape/tapeencoder.h \
+    ../rkdisk/rkimage/imagefile.h \
+    ../rkdisk/rkimage/rkhashtree.h \
+    ../rkdisk/rkimage/rkvolume.h \
+    ../rkdisk/rkimage/trackcodec.h \
+    ../rkdisk/rkimage/volume.h \
+    ../common/filestamp.h \
+    ../common/outputnames.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
+
+QMAKE_LFLAGS += -static -static-libgcc
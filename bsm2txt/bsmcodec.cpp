@@ -0,0 +1,577 @@
+/*
+ *  bsm2txt v. 2.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2016-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#include "bsmcodec.h"
+
+
+using namespace std;
+
+
+// characters 60h-7Fh: KOI-7 cyrillic letters and a block, UTF-8
+static constexpr const char* c_koi7Symbols[32] = {
+    "Ю", "А", "Б", "Ц", "Д", "Е", "Ф", "Г", "Х", "И", "Й", "К", "Л", "М", "Н", "О",
+    "П", "Я", "Р", "С", "Т", "У", "Ж", "В", "Ь", "Ы", "З", "Ш", "Э", "Щ", "Ч", "█"
+};
+
+// Basic Micron tokens 80h-DBh, the first 70 ones (up to MID$) are Radio-86RK BASIC tokens
+static constexpr const char* c_micronKeywords[] = {
+    "CLS", "FOR", "NEXT", "DATA", "INPUT", "DIM", "READ", "CUR", "GOTO", "RUN", "IF", "RESTORE", "GOSUB", "RETURN", "REM",
+    "STOP", "OUT", "ON", "PLOT", "LINE", "POKE", "PRINT", "DEF", "CONT", "LIST", "CLEAR", "CLOAD", "CSAVE", "NEW", "TAB(",
+    "TO", "SPC(", "FN", "THEN", "NOT", "STEP", "+", "-", "*", "/", "^", "AND", "OR", ">", "=", "<", "SGN", "INT", "ABS", "USR",
+    "FRE", "INP", "POS", "SQR", "RND", "LOG", "EXP", "COS", "SIN", "TAN", "ATN", "PEEK", "LEN", "STR$", "VAL", "ASC", "CHR$",
+    "LEFT$", "RIGHT$", "MID$", "SCREEN$(", "INKEY$", "AT", "&", "BEEP", "PAUSE", "VERIFY", "HOME", "EDIT", "DELETE",
+    "MERGE", "AUTO", "HIMEM", "@", "ASN", "ADDR", "PI", "RENUM", "ACS", "LG", "LPRINT", "LLIST"
+};
+
+static_assert(sizeof(c_micronKeywords) / sizeof(c_micronKeywords[0]) == 92, "Keyword table mismatch!");
+
+// characters 60h-7Fh: ASCII lower case letters
+static constexpr const char* c_asciiSymbols[32] = {
+    "`", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n", "o",
+    "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z", "{", "|", "}", "~", "?"
+};
+
+// MSX BASIC statement and operator tokens 81h-FCh
+static constexpr const char* c_msxKeywords[] = {
+    "END", "FOR", "NEXT", "DATA", "INPUT", "DIM", "READ", "LET", "GOTO", "RUN", "IF", "RESTORE", "GOSUB", "RETURN", "REM",
+    "STOP", "PRINT", "CLEAR", "LIST", "NEW", "ON", "WAIT", "DEF", "POKE", "CONT", "CSAVE", "CLOAD", "OUT", "LPRINT", "LLIST",
+    "CLS", "WIDTH", "ELSE", "TRON", "TROFF", "SWAP", "ERASE", "ERROR", "RESUME", "DELETE", "AUTO", "RENUM", "DEFSTR",
+    "DEFINT", "DEFSNG", "DEFDBL", "LINE", "OPEN", "FIELD", "GET", "PUT", "CLOSE", "LOAD", "MERGE", "FILES", "LSET", "RSET",
+    "SAVE", "LFILES", "CIRCLE", "COLOR", "DRAW", "PAINT", "BEEP", "PLAY", "PSET", "PRESET", "SOUND", "SCREEN", "VPOKE",
+    "SPRITE", "VDP", "BASE", "CALL", "TIME", "KEY", "MAX", "MOTOR", "BLOAD", "BSAVE", "DSKO$", "SET", "NAME", "KILL", "IPL",
+    "COPY", "CMD", "LOCATE", "TO", "THEN", "TAB(", "STEP", "USR", "FN", "SPC(", "NOT", "ERL", "ERR", "STRING$", "USING",
+    "INSTR", "'", "VARPTR", "CSRLIN", "ATTR$", "DSKI$", "OFF", "INKEY$", "POINT", ">", "=", "<", "+", "-", "*", "/", "^",
+    "AND", "OR", "XOR", "EQV", "IMP", "MOD", "\\"
+};
+
+static_assert(sizeof(c_msxKeywords) / sizeof(c_msxKeywords[0]) == 0xFC - 0x81 + 1, "Keyword table mismatch!");
+
+// MSX BASIC function tokens FFh 81h - FFh B0h
+static constexpr const char* c_msxFunctions[] = {
+    "LEFT$", "RIGHT$", "MID$", "SGN", "INT", "ABS", "SQR", "RND", "SIN", "LOG", "EXP", "COS", "TAN", "ATN", "FRE", "INP",
+    "POS", "LEN", "STR$", "VAL", "ASC", "CHR$", "PEEK", "VPEEK", "SPACE$", "OCT$", "HEX$", "LPOS", "BIN$", "CINT", "CSNG",
+    "CDBL", "FIX", "STICK", "STRIG", "PDL", "PAD", "DSKF", "FPOS", "CVI", "CVS", "CVD", "EOF", "LOC", "LOF", "MKI$",
+    "MKS$", "MKD$"
+};
+
+static_assert(sizeof(c_msxFunctions) / sizeof(c_msxFunctions[0]) == 0xB0 - 0x81 + 1, "Function table mismatch!");
+
+
+struct DialectInfo {
+    const char* name;
+    const char* const* keywords;  // tokens from firstToken
+    int nKeywords;
+    uint8_t firstToken;
+    const char* const* symbols;   // characters 60h-7Fh
+    uint8_t tokenData;
+    uint8_t tokenRem;
+    const char* const* functions; // FFh-prefixed tokens from 81h, MSX style numeric constants; nullptr if none
+    int nFunctions;
+};
+
+
+// indexed by BasicDialect
+static constexpr DialectInfo c_dialects[] = {
+    {"micron", c_micronKeywords, 92,  0x80, c_koi7Symbols,  0x83, 0x8E, nullptr,        0},
+    {"rk86",   c_micronKeywords, 70,  0x80, c_koi7Symbols,  0x83, 0x8E, nullptr,        0},
+    {"msx",    c_msxKeywords,    124, 0x81, c_asciiSymbols, 0x84, 0x8F, c_msxFunctions, 48}
+};
+
+static const int c_nDialects = sizeof(c_dialects) / sizeof(c_dialects[0]);
+
+static_assert(c_nDialects == BD_MSX + 1, "Dialect table mismatch!");
+
+
+bool parseBasicDialect(const string& name, BasicDialect& dialect)
+{
+    for (int i = 0; i < c_nDialects; i++)
+        if (name == c_dialects[i].name) {
+            dialect = BasicDialect(i);
+            return true;
+        }
+    return false;
+}
+
+
+// Converts the cyrillic letters and the block used in the tables from UTF-8 to cp866
+static string utf8ToCp866(const char* s)
+{
+    string res;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(s);
+    while (*p) {
+        if (*p < 0x80) {
+            res.push_back(char(*p++));
+        } else if ((*p & 0xE0) == 0xC0) {
+            unsigned cp = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+            p += 2;
+            if (cp >= 0x410 && cp < 0x440)
+                res.push_back(char(cp < 0x430 ? 0x80 + cp - 0x410 : 0xA0 + cp - 0x430));
+            else
+                res.push_back('?');
+        } else {
+            unsigned cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            p += 3;
+            res.push_back(cp == 0x2588 ? char(0xDB) : '?');
+        }
+    }
+    return res;
+}
+
+
+static vector<string> buildTokenTable(const DialectInfo& dialect, TextEncoding encoding)
+{
+    vector<string> table(256, "?");
+    table[0].clear();
+    for (int b = 0x20; b < 0x60; b++)
+        table[b] = string(1, char(b));
+    for (int b = 0x60; b < 0x80; b++)
+        table[b] = encoding == TE_UTF8 ? dialect.symbols[b - 0x60] : utf8ToCp866(dialect.symbols[b - 0x60]);
+    for (int i = 0; i < dialect.nKeywords; i++)
+        table[dialect.firstToken + i] = dialect.keywords[i];
+    return table;
+}
+
+
+// Output strings for every byte value, pre-encoded once per dialect and encoding
+static const vector<string>& getTokenTable(BasicDialect dialect, TextEncoding encoding)
+{
+    static const vector<vector<string>> tables = [] {
+        vector<vector<string>> tables;
+        for (const DialectInfo& dialect: c_dialects) {
+            tables.push_back(buildTokenTable(dialect, TE_CP866));
+            tables.push_back(buildTokenTable(dialect, TE_UTF8));
+        }
+        return tables;
+    }();
+
+    return tables[dialect * 2 + encoding];
+}
+
+
+// Formats an MSX BCD floating point constant: sign and exponent (excess 40h) byte, then nDigits BCD digits
+static string formatMsxFloat(const uint8_t* bytes, int nDigits, char typeChar)
+{
+    string digits;
+    for (int i = 0; i < nDigits / 2; i++) {
+        digits.push_back('0' + (bytes[1 + i] >> 4));
+        digits.push_back('0' + (bytes[1 + i] & 0x0F));
+    }
+    digits.erase(digits.find_last_not_of('0') + 1);
+
+    // value is 0.digits * 10^exp
+    int exp = (bytes[0] & 0x7F) - 0x40;
+    int nSignificant = digits.size();
+
+    string res = bytes[0] & 0x80 ? "-" : "";
+    if (digits.empty() || !bytes[0]) {
+        res = "0";
+    } else if (exp > 0 && exp <= nDigits) {
+        res += digits.substr(0, exp);
+        if (nSignificant > exp)
+            res += "." + digits.substr(exp);
+        else
+            res.append(exp - nSignificant, '0');
+    } else if (exp <= 0 && nSignificant - exp <= nDigits) {
+        res += "." + string(-exp, '0') + digits;
+    } else {
+        res += digits.substr(0, 1);
+        if (nSignificant > 1)
+            res += "." + digits.substr(1);
+        int e = exp - 1;
+        res += typeChar == '#' ? "D" : "E";
+        res += e < 0 ? "-" : "+";
+        res += to_string(abs(e) / 10) + to_string(abs(e) % 10);
+        return res;
+    }
+
+    // type suffix is needed if the constant would be read back as integer or single precision
+    if (res.find('.') == string::npos || (typeChar == '#' && nSignificant <= 6))
+        res.push_back(typeChar);
+
+    return res;
+}
+
+
+// Converts an MSX BASIC line from pos up to the terminating zero byte: FFh-prefixed function tokens,
+// binary numeric constants, ":ELSE" and ":REM'" are stored as tokens too
+static void detokenizeMsxLine(const uint8_t* data, size_t size, size_t& pos, const DialectInfo& dialect,
+                              const vector<string>& table, string& text)
+{
+    const uint8_t c_tokenElse = 0xA1;
+    const uint8_t c_tokenQuote = 0xE6;
+
+    bool inString = false;
+    bool inRem = false;
+    bool inData = false;
+
+    while (pos < size && data[pos]) {
+        uint8_t b = data[pos++];
+        if (inString || inRem || (inData && b != ':' && b != '"')) {
+            inString = inString && b != '"';
+            text.append(b < 0x80 ? table[b] : "?");
+            continue;
+        }
+        if (b == '"') {
+            inString = true;
+            text.push_back('"');
+            continue;
+        }
+        inData = false;
+
+        // number of bytes following a numeric constant token
+        size_t len = b == 0x0F ? 1 : b == 0x0B || b == 0x0C || b == 0x0D || b == 0x0E || b == 0x1C ? 2 :
+                     b == 0x1D ? 4 : b == 0x1F ? 8 : 0;
+        if (pos + len > size) {
+            pos = size;
+            return;
+        }
+        const uint8_t* p = data + pos;
+        unsigned word = len >= 2 ? p[0] | (p[1] << 8) : 0;
+        char buf[8];
+
+        if (b == ':' && pos < size && data[pos] == c_tokenElse) {
+            text.append(table[c_tokenElse]);
+            pos++;
+        } else if (b == ':' && pos + 1 < size && data[pos] == dialect.tokenRem && data[pos + 1] == c_tokenQuote) {
+            text.append(table[c_tokenQuote]);
+            pos += 2;
+            inRem = true;
+        } else if (b == 0xFF && pos < size && data[pos] >= 0x81 && data[pos] < 0x81 + dialect.nFunctions) {
+            text.append(dialect.functions[data[pos++] - 0x81]);
+        } else if (b >= 0x11 && b <= 0x1A) {
+            text.push_back('0' + b - 0x11);
+        } else if (b == 0x0F) {
+            text.append(to_string(p[0]));
+        } else if (b == 0x0E || b == 0x0D || b == 0x1C) {
+            // line pointers (0Dh) are converted back to line numbers before a program is saved
+            text.append(to_string(word));
+        } else if (b == 0x0B || b == 0x0C) {
+            snprintf(buf, sizeof(buf), b == 0x0B ? "&O%o" : "&H%X", word);
+            text.append(buf);
+        } else if (b == 0x1D || b == 0x1F) {
+            text.append(formatMsxFloat(p, b == 0x1D ? 6 : 14, b == 0x1D ? '!' : '#'));
+        } else {
+            text.append(table[b]);
+            inRem = b == dialect.tokenRem || b == c_tokenQuote;
+            inData = b == dialect.tokenData;
+        }
+        pos += len;
+    }
+}
+
+
+// Converts lines starting at pos: link (2 bytes, 0 = end of program), line number, tokens, 00.
+// If checkLinks is set, links must point to the next lines and line numbers must increase.
+static DetokenizeResult detokenizeLines(const uint8_t* data, size_t size, size_t pos, BasicDialect dialect, TextEncoding encoding,
+                                        bool checkLinks, string& text)
+{
+    const vector<string>& table = getTokenTable(dialect, encoding);
+    const DialectInfo& info = c_dialects[dialect];
+
+    text.clear();
+
+    int lineBase = 0;       // memory address of data[0] according to the first link
+    int prevLineNum = -1;
+
+    for (;;) {
+        if (pos >= size)
+            return DR_TRUNCATED;
+        unsigned link = data[pos] | (pos + 1 < size ? data[pos + 1] << 8 : 0);
+        if (!link)
+            return !checkLinks || prevLineNum >= 0 ? DR_OK : DR_NOT_BASIC;
+        if (pos + 4 > size)
+            return DR_TRUNCATED;
+
+        int lineNum = data[pos + 2] | (data[pos + 3] << 8);
+        if (checkLinks && lineNum <= prevLineNum)
+            return DR_NOT_BASIC;
+        prevLineNum = lineNum;
+        pos += 4;
+
+        size_t lineStart = text.size();
+        text.append(to_string(lineNum));
+        text.push_back(' ');
+
+        if (info.functions)
+            detokenizeMsxLine(data, size, pos, info, table, text);
+        else
+            while (pos < size && data[pos])
+                text.append(table[data[pos++]]);
+
+        text.push_back('\n');
+
+        if (pos++ >= size)
+            return DR_TRUNCATED;
+
+        if (checkLinks) {
+            if (lineStart == 0)
+                lineBase = int(link) - int(pos);
+            else if (int(link) - int(pos) != lineBase) {
+                text.resize(lineStart);
+                return DR_NOT_BASIC;
+            }
+        }
+    }
+}
+
+
+bool detokenizeBsm(const uint8_t* data, size_t size, BasicDialect dialect, TextEncoding encoding, string& text)
+{
+    size_t pos = 0;
+
+    // skip tape header: D3 D3 D3 name ... E6 D3 D3 D3 00, or D3 D3 D3 00 without name
+    while (pos < size && data[pos] == 0xD3)
+        pos++;
+    if (pos < size && data[pos++] != 0) {
+        while (pos < size && data[pos++] != 0xE6)
+            ;
+        while (pos < size && data[pos] == 0xD3)
+            pos++;
+        pos++;
+    }
+
+    return detokenizeLines(data, size, pos, dialect, encoding, false, text) == DR_OK;
+}
+
+
+DetokenizeResult detokenizeProgram(const uint8_t* data, size_t size, BasicDialect dialect, TextEncoding encoding, string& text)
+{
+    // the first link may have a zero low byte, so the leading zero byte is skipped only if links don't match otherwise
+    DetokenizeResult res = detokenizeLines(data, size, 0, dialect, encoding, true, text);
+    if (res != DR_OK && size && !data[0]) {
+        string text2;
+        DetokenizeResult res2 = detokenizeLines(data, size, 1, dialect, encoding, true, text2);
+        if (res2 == DR_OK || res == DR_NOT_BASIC) {
+            text.swap(text2);
+            res = res2;
+        }
+    }
+
+    return res;
+}
+
+
+// Keyword trie over characters 20h-5Fh (all keywords consist of them), built once from the dialect table
+class KeywordTrie
+{
+public:
+    KeywordTrie(const DialectInfo& dialect)
+    {
+        m_nodes.resize(1);
+        for (int i = 0; i < dialect.nKeywords; i++) {
+            int node = 0;
+            for (const char* p = dialect.keywords[i]; *p; p++) {
+                int16_t& next = m_nodes[node].next[*p - 0x20];
+                if (!next) {
+                    next = m_nodes.size();
+                    m_nodes.push_back(Node());
+                }
+                node = next;
+            }
+            m_nodes[node].token = dialect.firstToken + i;
+        }
+    }
+
+    // Finds the longest keyword at the start of codes, returns its token and length or 0
+    int match(const uint8_t* codes, size_t size, size_t& len) const
+    {
+        int node = 0;
+        int token = 0;
+        for (size_t i = 0; i < size && codes[i] >= 0x20 && codes[i] < 0x60; i++) {
+            node = m_nodes[node].next[codes[i] - 0x20];
+            if (!node)
+                break;
+            if (m_nodes[node].token) {
+                token = m_nodes[node].token;
+                len = i + 1;
+            }
+        }
+        return token;
+    }
+
+private:
+    struct Node {
+        Node() {memset(next, 0, sizeof(next));}
+        int16_t next[0x40];
+        int token = 0;
+    };
+
+    std::vector<Node> m_nodes;
+};
+
+
+// Decodes one character of the listing to a symbol code 20h-7Fh, returns -1 if it has no code.
+// Lower case letters are accepted too.
+static int decodeChar(const string& line, size_t& pos, BasicDialect dialect, TextEncoding encoding)
+{
+    // UTF-8 / cp866 symbols of codes 60h-7Fh
+    const vector<string>& table = getTokenTable(dialect, encoding);
+
+    uint8_t ch = line[pos];
+    if (ch < 0x80) {
+        pos++;
+        if (ch == '\t')
+            return ' ';
+        if (ch >= 'a' && ch <= 'z')
+            return ch - 0x20;
+        return ch >= 0x20 && ch < 0x60 ? ch : -1;
+    }
+
+    // multibyte UTF-8 sequence or cp866 byte
+    size_t len = 1;
+    if (encoding == TE_UTF8)
+        len = (ch & 0xE0) == 0xC0 ? 2 : (ch & 0xF0) == 0xE0 ? 3 : 4;
+    string sym = line.substr(pos, len);
+    pos += len;
+
+    // lower case cyrillic letters
+    if (encoding == TE_UTF8 && len == 2) {
+        unsigned cp = ((ch & 0x1F) << 6) | (sym[1] & 0x3F);
+        if (cp >= 0x430 && cp < 0x450) {
+            cp -= 0x20;
+            sym = {char(0xC0 | (cp >> 6)), char(0x80 | (cp & 0x3F))};
+        }
+    } else if (encoding == TE_CP866) {
+        if (ch >= 0xA0 && ch < 0xB0)
+            sym[0] = char(ch - 0x20);
+        else if (ch >= 0xE0 && ch < 0xF0)
+            sym[0] = char(ch - 0x50);
+    }
+
+    for (int code = 0x60; code < 0x80; code++)
+        if (table[code] == sym)
+            return code;
+
+    return -1;
+}
+
+
+bool canTokenize(BasicDialect dialect)
+{
+    return !c_dialects[dialect].functions;
+}
+
+
+bool tokenizeBsm(istream& text, BasicDialect dialect, TextEncoding encoding, const string& name, uint16_t firstLineAddr,
+                 vector<uint8_t>& data, int& errorLine)
+{
+    static const vector<KeywordTrie> tries(begin(c_dialects), end(c_dialects));
+    const KeywordTrie& trie = tries[dialect];
+    const DialectInfo& info = c_dialects[dialect];
+
+    data.clear();
+
+    // tape header: D3 D3 D3 name 00 00 00 E6 D3 D3 D3 00
+    data.insert(data.end(), 3, 0xD3);
+    for (size_t pos = 0; pos < name.size(); ) {
+        int code = decodeChar(name, pos, dialect, encoding);
+        data.push_back(code > 0x20 ? code : '_');
+    }
+    data.insert(data.end(), 3, 0x00);
+    data.push_back(0xE6);
+    data.insert(data.end(), 3, 0xD3);
+    data.push_back(0x00);
+
+    size_t programStart = data.size();
+
+    string line;
+    vector<uint8_t> codes;
+    errorLine = 0;
+    int prevLineNum = -1;
+
+    while (getline(text, line)) {
+        ++errorLine;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        // line number and a single space after it
+        size_t pos = line.find_first_not_of(' ');
+        if (pos == string::npos)
+            continue; // empty line
+        if (line[pos] < '0' || line[pos] > '9')
+            return false;
+        unsigned lineNum = 0;
+        while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9' && lineNum <= 0xFFFF)
+            lineNum = lineNum * 10 + line[pos++] - '0';
+        // line numbers must increase, as detokenizeProgram requires
+        if (lineNum > 0xFFFF || int(lineNum) <= prevLineNum)
+            return false;
+        prevLineNum = lineNum;
+        if (pos < line.size() && line[pos] == ' ')
+            pos++;
+
+        codes.clear();
+        while (pos < line.size()) {
+            int code = decodeChar(line, pos, dialect, encoding);
+            if (code < 0)
+                return false;
+            codes.push_back(code);
+        }
+
+        size_t lineStart = data.size();
+        data.insert(data.end(), 2, 0); // link, filled below
+        data.push_back(lineNum & 0xFF);
+        data.push_back(lineNum >> 8);
+
+        // tokens are not recognized in strings, after REM and in DATA statements
+        bool inString = false;
+        bool inRem = false;
+        bool inData = false;
+        for (size_t i = 0; i < codes.size(); ) {
+            uint8_t code = codes[i];
+            size_t len = 1;
+            int token = 0;
+            if (inString)
+                inString = code != '"';
+            else if (inRem)
+                ;
+            else if (code == '"')
+                inString = true;
+            else if (inData)
+                inData = code != ':';
+            else if ((token = trie.match(codes.data() + i, codes.size() - i, len))) {
+                code = token;
+                inRem = token == info.tokenRem;
+                inData = token == info.tokenData;
+            }
+            data.push_back(code);
+            i += len;
+        }
+        data.push_back(0);
+
+        uint16_t nextLineAddr = firstLineAddr + (data.size() - programStart);
+        data[lineStart] = nextLineAddr & 0xFF;
+        data[lineStart + 1] = nextLineAddr >> 8;
+    }
+
+    // end of program
+    data.push_back(0);
+    data.push_back(0);
+
+    errorLine = 0;
+    return !text.bad();
+}
@@ -0,0 +1,74 @@
+/*
+ *  bsm2txt v. 2.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2016-2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef BSMCODEC_H
+#define BSMCODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <istream>
+
+
+enum TextEncoding {
+    TE_CP866,
+    TE_UTF8
+};
+
+
+// BASIC dialects, indexed tables in bsmcodec.cpp
+enum BasicDialect {
+    BD_MICRON,  // Basic Micron
+    BD_RK86,    // Radio-86RK BASIC, Basic Micron extends its token table
+    BD_MSX      // MSX BASIC, converted to text only
+};
+
+
+enum DetokenizeResult {
+    DR_OK,
+    DR_TRUNCATED,   // text receives the lines decoded so far
+    DR_NOT_BASIC    // line links or numbers are inconsistent
+};
+
+
+// Parses a dialect name: "micron", "rk86", "msx"
+bool parseBasicDialect(const std::string& name, BasicDialect& dialect);
+
+// Returns false if tokenizeBsm doesn't support the dialect
+bool canTokenize(BasicDialect dialect);
+
+// Converts a tokenized program in bsm format (as saved by CSAVE, tape header is optional) to a text listing.
+// Returns false if the program is truncated, text receives the lines decoded so far.
+bool detokenizeBsm(const uint8_t* data, size_t size, BasicDialect dialect, TextEncoding encoding, std::string& text);
+
+// Converts program text as it's stored in memory (tape image body, RK DOS file) to a text listing.
+// Leading zero byte is optional, line links are verified to tell BASIC programs from other files.
+DetokenizeResult detokenizeProgram(const uint8_t* data, size_t size, BasicDialect dialect, TextEncoding encoding, std::string& text);
+
+// Converts a text listing (as written by detokenizeBsm) to a tokenized program with tape header,
+// the listing is read line by line. firstLineAddr is the memory address of the first line used
+// for line links. Line numbers must increase. Returns false on error, errorLine receives the number
+// of the bad text line.
+bool tokenizeBsm(std::istream& text, BasicDialect dialect, TextEncoding encoding, const std::string& name, uint16_t firstLineAddr,
+                 std::vector<uint8_t>& data, int& errorLine);
+
+#endif // BSMCODEC_H
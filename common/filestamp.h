@@ -0,0 +1,65 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILESTAMP_H
+#define FILESTAMP_H
+
+#include <cstdint>
+#include <string>
+
+#include <sys/stat.h>
+
+
+// Size and modification/status change times of a file, tells if the file has changed since it was indexed.
+// Times are in nanoseconds where the platform provides them: a file may be rewritten within a second
+// without changing its size.
+struct FileStamp {
+    uint64_t size;
+    int64_t mtime;
+    int64_t ctime;
+
+    bool operator==(const FileStamp& other) const
+    {
+        return size == other.size && mtime == other.mtime && ctime == other.ctime;
+    }
+};
+
+
+// Returns false if the file doesn't exist or isn't a regular file
+inline bool getFileStamp(const std::string& fileName, FileStamp& stamp)
+{
+    struct stat st;
+    if (stat(fileName.c_str(), &st) || !S_ISREG(st.st_mode))
+        return false;
+
+    stamp.size = st.st_size;
+#if defined(_WIN32)
+    stamp.mtime = int64_t(st.st_mtime) * 1000000000;
+    stamp.ctime = int64_t(st.st_ctime) * 1000000000;
+#elif defined(__APPLE__)
+    stamp.mtime = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+    stamp.ctime = int64_t(st.st_ctimespec.tv_sec) * 1000000000 + st.st_ctimespec.tv_nsec;
+#else
+    stamp.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.ctime = int64_t(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+
+    return true;
+}
+
+#endif // FILESTAMP_H
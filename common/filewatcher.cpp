@@ -0,0 +1,154 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "filewatcher.h"
+
+
+using namespace std;
+
+
+void splitFileName(const string& fileName, string& dirName, string& name)
+{
+    size_t slashPos = fileName.find_last_of('/');
+    if (slashPos == string::npos) {
+        dirName = ".";
+        name = fileName;
+    } else {
+        dirName = slashPos ? fileName.substr(0, slashPos) : "/";
+        name = fileName.substr(slashPos + 1);
+    }
+}
+
+
+static void addUnique(vector<string>& names, const string& name)
+{
+    if (find(names.begin(), names.end(), name) == names.end())
+        names.push_back(name);
+}
+
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher()
+{
+    m_fd = inotify_init1(IN_CLOEXEC);
+}
+
+
+FileWatcher::~FileWatcher()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+
+bool FileWatcher::addDir(const string& dirName)
+{
+    for (const auto& dir: m_dirs)
+        if (dir.second == dirName)
+            return true;
+
+    int wd = inotify_add_watch(m_fd, dirName.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+    if (wd < 0)
+        return false;
+
+    m_dirs[wd] = dirName;
+    return true;
+}
+
+
+bool FileWatcher::wait(vector<string>& changedFiles, vector<string>& deletedFiles, int latencyMs)
+{
+    changedFiles.clear();
+    deletedFiles.clear();
+
+    alignas(inotify_event) char buf[0x10000];
+    int timeout = -1;  // wait for the first event without timeout
+
+    for (;;) {
+        pollfd pfd = {m_fd, POLLIN, 0};
+        int res = poll(&pfd, 1, timeout);
+        if (res < 0)
+            return false;
+        if (res == 0)
+            return true;
+
+        ssize_t len = read(m_fd, buf, sizeof(buf));
+        if (len <= 0)
+            return false;
+
+        for (char* p = buf; p < buf + len; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            auto dir = m_dirs.find(event->wd);
+            if (dir == m_dirs.end() || !event->len || (event->mask & IN_ISDIR))
+                continue;
+
+            string fileName = dir->second + "/" + event->name;
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                addUnique(changedFiles, fileName);
+                deletedFiles.erase(remove(deletedFiles.begin(), deletedFiles.end(), fileName), deletedFiles.end());
+            } else {
+                addUnique(deletedFiles, fileName);
+                changedFiles.erase(remove(changedFiles.begin(), changedFiles.end(), fileName), changedFiles.end());
+            }
+        }
+
+        timeout = latencyMs;
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{
+}
+
+
+FileWatcher::~FileWatcher()
+{
+}
+
+
+bool FileWatcher::addDir(const string&)
+{
+    return false;
+}
+
+
+bool FileWatcher::wait(vector<string>&, vector<string>&, int)
+{
+    return false;
+}
+
+#endif // __linux__
+
+
+bool FileWatcher::isValid()
+{
+    return m_fd >= 0;
+}
@@ -0,0 +1,54 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+
+// Waits for files to be written, replaced or deleted in watched directories.
+// Directories are watched rather than files, so files replaced by rename are
+// tracked too. Uses inotify, on other platforms isValid() returns false.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    bool isValid();
+
+    bool addDir(const std::string& dirName);
+
+    // Blocks until something changes. Changes are collected for latencyMs after the first
+    // one, so a file written in several steps is reported once. File names are returned
+    // as dirName + "/" + name with dirName as passed to addDir().
+    bool wait(std::vector<std::string>& changedFiles, std::vector<std::string>& deletedFiles, int latencyMs = 20);
+
+private:
+    int m_fd = -1;
+    std::map<int, std::string> m_dirs;
+};
+
+
+// Splits a file name into the directory to watch and the name in it
+void splitFileName(const std::string& fileName, std::string& dirName, std::string& name);
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,72 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OUTPUTNAMES_H
+#define OUTPUTNAMES_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+
+
+// Output files are named after the input file name without path and extension (outputDir/<name>...),
+// the extension is kept (outputDir/<name>.<ext>...) for inputs which would get the same name otherwise.
+// Names are compared case-insensitively as on Windows. Returns false and prints the inputs if names
+// still collide, so parallel workers never write the same file.
+inline bool makeOutputBaseNames(const std::vector<std::string>& fileNames, const std::string& outputDir,
+                                std::vector<std::string>& baseNames)
+{
+    auto lowerCase = [](std::string name) {
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        return name;
+    };
+
+    auto stem = [](const std::string& name) {
+        return name.substr(0, name.find_last_of('.'));
+    };
+
+    std::vector<std::string> namesWoPath;
+    std::map<std::string, int> nStems;
+    for (const std::string& fileName: fileNames) {
+        namesWoPath.push_back(fileName.substr(fileName.find_last_of("/\\:") + 1));
+        ++nStems[lowerCase(stem(namesWoPath.back()))];
+    }
+
+    std::map<std::string, std::string> sources;
+    baseNames.clear();
+    for (unsigned i = 0; i < fileNames.size(); i++) {
+        std::string baseName = nStems[lowerCase(stem(namesWoPath[i]))] > 1 ? namesWoPath[i] : stem(namesWoPath[i]);
+        if (!outputDir.empty())
+            baseName = outputDir + "/" + baseName;
+
+        auto it = sources.find(lowerCase(baseName));
+        if (it != sources.end()) {
+            std::cout << "Files " << it->second << " and " << fileNames[i] << " would get the same output name "
+                      << baseName << "!" << std::endl;
+            return false;
+        }
+        sources[lowerCase(baseName)] = fileNames[i];
+        baseNames.push_back(baseName);
+    }
+
+    return true;
+}
+
+#endif // OUTPUTNAMES_H
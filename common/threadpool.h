@@ -0,0 +1,61 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+
+// Calls func(n) for every n in [0, count) on a pool of worker threads.
+// Jobs are handed out one by one, so long and short jobs may be mixed freely.
+// nThreads <= 0 means one thread per CPU core.
+template <typename Func>
+void runParallel(int count, Func func, int nThreads = 0)
+{
+    if (nThreads <= 0)
+        nThreads = std::thread::hardware_concurrency();
+    if (nThreads <= 0)
+        nThreads = 1;
+    if (nThreads > count)
+        nThreads = count;
+
+    if (nThreads <= 1) {
+        for (int n = 0; n < count; n++)
+            func(n);
+        return;
+    }
+
+    std::atomic<int> nextJob(0);
+
+    auto worker = [&]() {
+        int n;
+        while ((n = nextJob++) < count)
+            func(n);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.push_back(std::thread(worker));
+
+    for (auto& thread: threads)
+        thread.join();
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,330 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <cstring>
+
+#include "rkcatalog.h"
+#include "rkimage/rkvolume.h"
+#include "../common/hash.h"
+#include "../common/threadpool.h"
+
+using namespace std;
+
+
+#pragma pack(push, 1)
+
+struct CatalogHeader {
+    char magic[4];      // "RKCT"
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t nImages;
+    uint32_t nFiles;
+    uint32_t namesSize; // size of the image file names pool
+};
+
+struct CatalogImage {
+    uint64_t size;
+    int64_t mtime;      // nanoseconds
+    int64_t ctime;
+    uint32_t nameOffset;
+    uint8_t valid;
+    uint8_t reserved[3];
+};
+
+#pragma pack(pop)
+
+static const char c_catalogMagic[4] = {'R', 'K', 'C', 'T'};
+static const uint16_t c_catalogVersion = 2;
+
+
+static int compareFiles(const RkCatalogFile& x, const RkCatalogFile& y)
+{
+    int res = strncmp(x.fileName, y.fileName, sizeof(x.fileName));
+    if (res)
+        return res;
+    return x.image < y.image ? -1 : x.image > y.image;
+}
+
+
+// matches the whole name, * is any sequence, ? is any character
+static bool matchPattern(const char* name, const char* nameEnd, const char* pattern)
+{
+    const char* starPattern = nullptr;
+    const char* starName = nullptr;
+
+    while (name != nameEnd) {
+        if (*pattern == '*') {
+            starPattern = ++pattern;
+            starName = name;
+        } else if (*pattern && (*pattern == '?' || *pattern == *name)) {
+            ++pattern;
+            ++name;
+        } else if (starPattern) {
+            pattern = starPattern;
+            name = ++starName;
+        } else
+            return false;
+    }
+
+    while (*pattern == '*')
+        ++pattern;
+
+    return !*pattern;
+}
+
+
+bool RkCatalog::load(const string& fileName)
+{
+    m_images.clear();
+    m_files.clear();
+    m_hashIndex.clear();
+
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail())
+        return true;
+
+    CatalogHeader header;
+    f.read((char*)&header, sizeof(header));
+    if (f.fail() || memcmp(header.magic, c_catalogMagic, sizeof(header.magic)) || header.version > c_catalogVersion)
+        return false;
+
+    // catalog of an older version is rebuilt as if it were missing
+    if (header.version < c_catalogVersion)
+        return true;
+
+    vector<CatalogImage> images(header.nImages);
+    string names(header.namesSize, '\0');
+    m_files.resize(header.nFiles);
+    m_hashIndex.resize(header.nFiles);
+
+    f.read((char*)images.data(), images.size() * sizeof(CatalogImage));
+    f.read(&names[0], names.size());
+    f.read((char*)m_files.data(), m_files.size() * sizeof(RkCatalogFile));
+    f.read((char*)m_hashIndex.data(), m_hashIndex.size() * sizeof(uint32_t));
+    if (f.fail())
+        return false;
+
+    for (const CatalogImage& image: images) {
+        if (image.nameOffset >= names.size())
+            return false;
+        m_images.push_back({names.c_str() + image.nameOffset, {image.size, image.mtime, image.ctime}, image.valid != 0});
+    }
+
+    for (const RkCatalogFile& file: m_files)
+        if (file.image >= m_images.size())
+            return false;
+
+    for (uint32_t n: m_hashIndex)
+        if (n >= m_files.size())
+            return false;
+
+    return true;
+}
+
+
+bool RkCatalog::save(const string& fileName)
+{
+    ofstream f(fileName, ofstream::binary);
+    if (f.fail())
+        return false;
+
+    string names;
+    vector<CatalogImage> images;
+    for (const ImageInfo& image: m_images) {
+        images.push_back({image.stamp.size, image.stamp.mtime, image.stamp.ctime, (uint32_t)names.size(), image.valid, {}});
+        names.append(image.fileName);
+        names.push_back('\0');
+    }
+
+    CatalogHeader header = {{}, c_catalogVersion, 0, (uint32_t)m_images.size(), (uint32_t)m_files.size(), (uint32_t)names.size()};
+    memcpy(header.magic, c_catalogMagic, sizeof(header.magic));
+
+    f.write((const char*)&header, sizeof(header));
+    f.write((const char*)images.data(), images.size() * sizeof(CatalogImage));
+    f.write(names.data(), names.size());
+    f.write((const char*)m_files.data(), m_files.size() * sizeof(RkCatalogFile));
+    f.write((const char*)m_hashIndex.data(), m_hashIndex.size() * sizeof(uint32_t));
+
+    f.close();
+
+    return !f.fail();
+}
+
+
+// Reads all files of an image, throws on image errors
+static void scanImage(const string& imageFileName, uint32_t image, vector<RkCatalogFile>& files)
+{
+    RkVolume vol(imageFileName, IFM_READ_ONLY);
+    if (!vol.isValid())
+        throw RkVolume::RkVolumeException {RkVolume::RkVolumeException::RVET_BAD_DISK_FORMAT};
+
+    for (const RkFileInfo& fi: *vol.getFileList()) {
+        int size = 0;
+        uint8_t* data = vol.readFile(fi.fileName, size);
+
+        RkCatalogFile file = {};
+        memcpy(file.fileName, fi.fileName.data(), min(fi.fileName.size(), sizeof(file.fileName)));
+        file.hash = hash64(data, size);
+        file.image = image;
+        file.size = size;
+        file.addr = fi.addr;
+        file.attr = fi.attr;
+        files.push_back(file);
+
+        delete[] data;
+    }
+}
+
+
+int RkCatalog::update(const vector<string>& imageFileNames, int nThreads, ostream& log, int& nErrors)
+{
+    // previous image entries and their files
+    map<string, int> oldImages;
+    for (unsigned i = 0; i < m_images.size(); i++)
+        oldImages[m_images[i].fileName] = i;
+
+    vector<vector<RkCatalogFile>> oldFiles(m_images.size());
+    for (const RkCatalogFile& file: m_files)
+        oldFiles[file.image].push_back(file);
+
+    vector<ImageInfo> images;
+    vector<vector<RkCatalogFile>> files;
+    vector<int> imagesToScan;
+
+    nErrors = 0;
+
+    for (const string& imageFileName: imageFileNames) {
+        FileStamp stamp;
+        if (!getFileStamp(imageFileName, stamp)) {
+            log << imageFileName << ": file not found!" << endl;
+            ++nErrors;
+            continue;
+        }
+
+        uint32_t image = images.size();
+        images.push_back({imageFileName, stamp, true});
+        files.emplace_back();
+
+        auto it = oldImages.find(imageFileName);
+        if (it != oldImages.end() && m_images[it->second].stamp == stamp) {
+            images.back().valid = m_images[it->second].valid;
+            files.back().swap(oldFiles[it->second]);
+            for (RkCatalogFile& file: files.back())
+                file.image = image;
+        } else
+            imagesToScan.push_back(image);
+    }
+
+    mutex logMutex;
+
+    runParallel(imagesToScan.size(), [&](int n) {
+        int image = imagesToScan[n];
+        ostringstream imageLog;
+        imageLog << images[image].fileName << ": ";
+
+        try {
+            scanImage(images[image].fileName, image, files[image]);
+            imageLog << files[image].size() << " file(s)" << endl;
+        }
+
+        catch (RkVolume::RkVolumeException&) {
+            images[image].valid = false;
+            files[image].clear();
+            imageLog << "bad disk image!" << endl;
+        }
+
+        catch (ImageFileException&) {
+            images[image].valid = false;
+            files[image].clear();
+            imageLog << "file read error!" << endl;
+        }
+
+        lock_guard<mutex> lock(logMutex);
+        if (!images[image].valid)
+            ++nErrors;
+        log << imageLog.str();
+    }, nThreads);
+
+    m_images.swap(images);
+    m_files.clear();
+    for (const auto& imageFiles: files)
+        m_files.insert(m_files.end(), imageFiles.begin(), imageFiles.end());
+
+    buildIndex();
+
+    return imagesToScan.size();
+}
+
+
+void RkCatalog::buildIndex()
+{
+    sort(m_files.begin(), m_files.end(), [](const RkCatalogFile& x, const RkCatalogFile& y) {
+        return compareFiles(x, y) < 0;
+    });
+
+    m_hashIndex.resize(m_files.size());
+    for (unsigned i = 0; i < m_files.size(); i++)
+        m_hashIndex[i] = i;
+
+    stable_sort(m_hashIndex.begin(), m_hashIndex.end(), [this](uint32_t x, uint32_t y) {
+        return m_files[x].hash < m_files[y].hash;
+    });
+}
+
+
+vector<const RkCatalogFile*> RkCatalog::findByName(const string& pattern) const
+{
+    string upperPattern = pattern;
+    transform(upperPattern.begin(), upperPattern.end(), upperPattern.begin(), ::toupper);
+
+    // the part before the first wildcard selects the range of sorted records
+    string prefix = upperPattern.substr(0, upperPattern.find_first_of("*?"));
+
+    auto it = lower_bound(m_files.begin(), m_files.end(), prefix, [](const RkCatalogFile& file, const string& prefix) {
+        return strncmp(file.fileName, prefix.c_str(), sizeof(file.fileName)) < 0;
+    });
+
+    vector<const RkCatalogFile*> result;
+    for (; it != m_files.end() && !strncmp(it->fileName, prefix.c_str(), min(prefix.size(), sizeof(it->fileName))); ++it) {
+        const char* nameEnd = it->fileName;
+        while (nameEnd != it->fileName + sizeof(it->fileName) && *nameEnd)
+            ++nameEnd;
+        if (matchPattern(it->fileName, nameEnd, upperPattern.c_str()))
+            result.push_back(&*it);
+    }
+
+    return result;
+}
+
+
+vector<const RkCatalogFile*> RkCatalog::findByHash(uint64_t hash) const
+{
+    auto it = lower_bound(m_hashIndex.begin(), m_hashIndex.end(), hash, [this](uint32_t n, uint64_t hash) {
+        return m_files[n].hash < hash;
+    });
+
+    vector<const RkCatalogFile*> result;
+    for (; it != m_hashIndex.end() && m_files[*it].hash == hash; ++it)
+        result.push_back(&m_files[*it]);
+
+    return result;
+}
@@ -0,0 +1,80 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RKCATALOG_H
+#define RKCATALOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "../common/filestamp.h"
+
+
+#pragma pack(push, 1)
+
+// catalog file record, one per file in an image
+struct RkCatalogFile {
+    char fileName[16];  // RK DOS file name, zero padded
+    uint64_t hash;      // hash64 of the file content
+    uint32_t image;     // index in the image table
+    uint32_t size;
+    uint16_t addr;
+    uint8_t attr;
+    uint8_t reserved;
+};
+
+#pragma pack(pop)
+
+
+// Catalog of files in a library of RK DOS images.
+// The catalog file holds the image table and the file records sorted by name followed by an index
+// sorted by content hash, so name and hash lookups are binary searches over the loaded file.
+class RkCatalog
+{
+public:
+    struct ImageInfo {
+        std::string fileName;
+        FileStamp stamp;
+        bool valid;     // false if the image can't be read, it's kept to avoid rescanning
+    };
+
+    // missing catalog file or catalog of an older version is not an error, the catalog is empty then
+    bool load(const std::string& fileName);
+    bool save(const std::string& fileName);
+
+    // Makes the catalog describe the given images. Images with unchanged size, modification and status
+    // change times aren't read again, others are scanned in parallel. Returns the number of scanned images.
+    int update(const std::vector<std::string>& imageFileNames, int nThreads, std::ostream& log, int& nErrors);
+
+    // name pattern may contain wildcards * and ?, case is ignored
+    std::vector<const RkCatalogFile*> findByName(const std::string& pattern) const;
+    std::vector<const RkCatalogFile*> findByHash(uint64_t hash) const;
+
+    const std::vector<ImageInfo>& getImages() const {return m_images;}
+    const std::vector<RkCatalogFile>& getFiles() const {return m_files;}
+
+private:
+    std::vector<ImageInfo> m_images;
+    std::vector<RkCatalogFile> m_files;     // sorted by name and image
+    std::vector<uint32_t> m_hashIndex;      // indexes in m_files sorted by hash
+
+    void buildIndex();
+};
+
+#endif // RKCATALOG_H
@@ -21,9 +21,30 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cstring>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #include "rkimage/rkvolume.h"
+#include "rkcatalog.h"
+#include "rksearch.h"
+#include "rkstore.h"
+#include "rkpatch.h"
+#include "rkimage/rkhashtree.h"
+#include "../bin2tape/tapedecoder.h"
+#include "../common/filewatcher.h"
+#include "../common/threadpool.h"
 
 
 #define VERSION "1.02"
@@ -31,17 +52,25 @@
 
 using namespace std;
 
+
+// standard output saved before messages are redirected to stderr (see main)
+static streambuf* const stdoutBuf = cout.rdbuf();
+
+// copy-on-write overlay given with -v, the image itself is left intact if it's set
+static string overlayFileName;
+
+
 void usage(const string& moduleName)
 {
             cout << "Usage: " << moduleName << " <command> [<options>...] <image_file.rdi> [<rk_file>] [<target_file>]" << endl << endl <<
                     "Commands:" << endl << endl <<
-                    "    a   Add file to image" << endl <<
+                    "    a   Add file to image, <target_file> is the name in image (default is rk_file name)" << endl <<
                     "        options:" << endl <<
                     "            -a addr - starting Address (hex), default = 0000" << endl <<
                     "            -o      - Overwrite file if exists" << endl <<
                     "            -r      - set \"Read only\" attribute" << endl <<
                     "            -h      - set \"Hidden\" attribute" << endl <<
-                    "    x   eXtract file from image" << endl <<
+                    "    x   eXtract file from image to <target_file> (default is rk_file name)" << endl <<
                     "    d   Delete file from image" << endl <<
                     "    l   List files in image" << endl <<
                     "        options:" << endl <<
@@ -50,10 +79,76 @@ void usage(const string& moduleName)
                     "        options:" << endl <<
                     "            -y      - don't ask to confirm" << endl <<
                     "            -s size - directory Size in sectors (default 4)" << endl <<
+                    "    i   Import programs from tape images (rk*, rks, rko, bru/ord, cas, lvt)," << endl <<
+                    "        load address and name are taken from tape header:" << endl <<
+                    "        rkdisk i [<options>...] <image_file.rdi> <tape_file>..." << endl <<
+                    "        options:" << endl <<
+                    "            -o      - Overwrite files if exist" << endl <<
+                    "            -f      - import even if checksum doesn't match" << endl <<
+                    "            -r      - set \"Read only\" attribute" << endl <<
+                    "            -h      - set \"Hidden\" attribute" << endl <<
                     "    t   set file aTtributes" << endl <<
                     "        options:" << endl <<
                     "            -r      - set \"Read only\" attribute" << endl <<
                     "            -h      - set \"Hidden\" attribute" << endl <<
+                    "    w   Watch host directory <rk_file> and keep image in sync with it:" << endl <<
+                    "        changed files are written to image, deleted files are deleted" << endl <<
+                    "        from image (only changed sectors are rewritten), Ctrl+C to stop" << endl <<
+                    "        options:" << endl <<
+                    "            -a addr - starting Address (hex), default = 0000" << endl <<
+                    "    c   create or update Catalog of image library, <image_file.rdi> is the catalog file:" << endl <<
+                    "        rkdisk c [<options>...] <catalog_file> <image_file.rdi>|<directory>..." << endl <<
+                    "        images with unchanged size, modification and status change times are not read again" << endl <<
+                    "        options:" << endl <<
+                    "            -j threads - number of worker threads, default = number of CPU cores" << endl <<
+                    "    q   Query catalog for files by name (wildcards * and ? are allowed) or content hash:" << endl <<
+                    "        rkdisk q [<options>...] <catalog_file> <name>|<hash>" << endl <<
+                    "        options:" << endl <<
+                    "            -c      - query by Content hash (hex) instead of name" << endl <<
+                    "    s   Search all files in images for byte strings, image, file, offset and" << endl <<
+                    "        load address are reported for each match:" << endl <<
+                    "        rkdisk s <options>... <image_file.rdi>|<directory>..." << endl <<
+                    "        options (-t and -x may be repeated):" << endl <<
+                    "            -t text    - search for Text" << endl <<
+                    "            -x bytes   - search for bytes given in heX (\"CD0300\")" << endl <<
+                    "            -j threads - number of worker threads, default = number of CPU cores" << endl <<
+                    "    p   Put images to content-addressed store <store_dir>, every distinct file is" << endl <<
+                    "        kept once, deduplication savings are reported; images are identified by file" << endl <<
+                    "        name, images with the same name in different directories can't be put at once:" << endl <<
+                    "        rkdisk p [<options>...] <store_dir> <image_file.rdi>|<directory>..." << endl <<
+                    "        options:" << endl <<
+                    "            -j threads - number of worker threads, default = number of CPU cores" << endl <<
+                    "    u   Unpack image from store, the image is rebuilt byte for byte:" << endl <<
+                    "        rkdisk u <store_dir> <image_file.rdi> [<target_file>]" << endl <<
+                    "    e   comparE images, report added, removed and changed files and sectors and" << endl <<
+                    "        write delta patch containing changed sector data if <patch_file> is given:" << endl <<
+                    "        rkdisk e <image_file.rdi> <new_image_file.rdi> [<patch_file>]" << endl <<
+                    "    y   applY delta patch to image, the image is updated in place (only changed" << endl <<
+                    "        sectors are rewritten) unless <target_file> is given:" << endl <<
+                    "        rkdisk y <image_file.rdi> <patch_file> [<target_file>]" << endl <<
+                    "    h   compare images by Hash trees, the root hash of each image is printed," << endl <<
+                    "        changed sectors and files are reported if second image is given:" << endl <<
+                    "        rkdisk h [<options>...] <image_file.rdi> [<image_file2.rdi>]" << endl <<
+                    "        hash tree stored as <image_file.rdi>.rkh is used while image size and" << endl <<
+                    "        modification and status change times are unchanged" << endl <<
+                    "        options:" << endl <<
+                    "            -w      - Write hash tree files next to images" << endl <<
+                    "    z   pack image (Zip), tracks are packed independently, packed images are" << endl <<
+                    "        opened by all commands as usual and only changed tracks are rewritten:" << endl <<
+                    "        rkdisk z [<options>...] <image_file.rdi> <target_file>" << endl <<
+                    "        options:" << endl <<
+                    "            -u      - Unpack image" << endl <<
+                    "    o   commit Overlay file to image (changed blocks are written to image)" << endl <<
+                    "        and delete it:" << endl <<
+                    "        rkdisk o [<options>...] <image_file.rdi> <overlay_file>" << endl <<
+                    "        options:" << endl <<
+                    "            -d      - Discard overlay without changing image" << endl << endl <<
+                    "Option -v overlay_file for commands a, x, d, l, t, i, w opens image in copy-on-write" << endl <<
+                    "mode: image is not modified, changed blocks are written to overlay file, which is" << endl <<
+                    "applied to image data next time it's given" << endl << endl <<
+                    "\"-\" as <rk_file> for commands a and y, as <target_file> for commands x, u, y" << endl <<
+                    "and as <patch_file> for command e means" << endl <<
+                    "standard input and standard output, messages are written to standard error then" << endl <<
                     endl;
 }
 
@@ -80,9 +175,18 @@ string makeRkDosFileName(const string& rkFileName)
 }
 
 
+string getAttrString(uint8_t attr)
+{
+    string attrStr = attr & 0x80 ? "R" : "";
+    if (attr & 0x40)
+        attrStr += "H";
+    return attrStr;
+}
+
+
 void listFiles(const string& imageFileName, bool briefListing)
 {
-    RkVolume vol(imageFileName, IFM_READ_ONLY);
+    RkVolume vol(imageFileName, IFM_READ_ONLY, overlayFileName);
 
     auto fileList = vol.getFileList();
 
@@ -91,14 +195,11 @@ void listFiles(const string& imageFileName, bool briefListing)
         cout << "----          " << "\t" << "----" << "\t" << "------" << "\t" << "  -----" << "\t" << "  ----" << endl;
 
         for (const auto& fi: *fileList) {
-            string attr = fi.attr & 0x80 ? "R" : "";
-            if (fi.attr & 0x40)
-                attr += "H";
             cout << left << setw(14) << setfill(' ') << fi.fileName << "\t"
                  << right << setw(4) << setfill('0') << hex << fi.addr << "\t"
                  << setw(6) << setfill(' ') << dec << fi.sCount << "\t"
                  << setw(7) << setfill(' ') << dec << fi.fileSize << "\t"
-                 << setw(6) << attr << endl;
+                 << setw(6) << getAttrString(fi.attr) << endl;
         }
     } else {
         int i = 0;
@@ -119,7 +220,7 @@ void listFiles(const string& imageFileName, bool briefListing)
 
 void deleteFile(const string& imageFileName, const string& rkFileName)
 {
-    RkVolume vol(imageFileName, IFM_READ_WRITE);
+    RkVolume vol(imageFileName, IFM_READ_WRITE, overlayFileName);
     vol.deleteFile(rkFileName);
     vol.saveImage();
 }
@@ -127,66 +228,122 @@ void deleteFile(const string& imageFileName, const string& rkFileName)
 
 void setAttributes(const string& imageFileName, const string& rkFileName, bool readOnly, bool hidden)
 {
-    RkVolume vol(imageFileName, IFM_READ_WRITE);
+    RkVolume vol(imageFileName, IFM_READ_WRITE, overlayFileName);
     uint8_t attr = (readOnly ? 0x80 : 0) | (hidden ? 0x40 : 0);
     vol.setAttributes(rkFileName, attr);
     vol.saveImage();
 }
 
 
-bool addFile(const string& imageFileName, const string& rkFileName, uint16_t addr, bool readOnly, bool hidden, bool allowOverwrite)
+// "-" means standard input, the file is read in large blocks, so pipes are supported
+bool loadHostFile(const string& fileName, vector<uint8_t>& data)
 {
-    ifstream rkFile(rkFileName, ios::binary);
-    if (!rkFile.is_open()) {
-        cout << "error opening file " << rkFileName << endl;
-        return false;
+    ifstream file;
+    istream* in = &cin;
+    if (fileName != "-") {
+        file.open(fileName, ios::binary);
+        if (!file.is_open())
+            return false;
+        in = &file;
     }
 
-    rkFile.seekg(0, ios::end);
-    int size = rkFile.tellg();
-    rkFile.seekg(0, ios::beg);
-    uint8_t* buf = new uint8_t[size];
-    rkFile.read((char*)buf, size);
+    const size_t blockSize = 0x10000;
+    data.clear();
+    do {
+        size_t size = data.size();
+        data.resize(size + blockSize);
+        in->read((char*)data.data() + size, blockSize);
+        data.resize(size + in->gcount());
+    } while (*in);
 
-    if (rkFile.rdstate()) {
-        cout << "error reading file " << rkFileName << endl;
-        delete[] buf;
-        return false;
+    return !in->bad();
+}
+
+
+// "-" means standard output
+bool saveHostFile(const string& fileName, const uint8_t* data, size_t size)
+{
+    ofstream file;
+    ostream out(stdoutBuf);
+    if (fileName != "-") {
+        file.open(fileName, ios::binary | std::fstream::trunc);
+        if (!file.is_open())
+            return false;
+        out.rdbuf(file.rdbuf());
+    }
+
+    out.write((const char*)data, size);
+    out.flush();
+
+    return !out.rdstate();
+}
+
+
+// Writes changed blocks from the overlay to the image or just drops them, the overlay is deleted.
+// Overlay made for another image can only be discarded.
+void commitOverlay(const string& imageFileName, const string& overlayFile, bool discard)
+{
+    try {
+        ImageFile image(imageFileName, overlayFile);
+        if (discard)
+            image.discardOverlay();
+        else
+            image.commitOverlay();
+    }
+
+    catch (ImageFileException& e) {
+        if (!discard || e != IFE_OVERLAY_MISMATCH)
+            throw;
+        remove(overlayFile.c_str());
     }
+}
 
-    rkFile.close();
 
-    RkVolume vol(imageFileName, IFM_READ_WRITE);
+bool addFile(const string& imageFileName, const string& rkFileName, const string& hostFileName, uint16_t addr, bool readOnly, bool hidden, bool allowOverwrite)
+{
+    vector<uint8_t> data;
+    if (!loadHostFile(hostFileName, data)) {
+        cout << "error reading file " << hostFileName << endl;
+        return false;
+    }
+
+    RkVolume vol(imageFileName, IFM_READ_WRITE, overlayFileName);
 
     uint8_t attr = (readOnly ? 0x80 : 0) | (hidden ? 0x40 : 0);
 
-    vol.writeFile(rkFileName, buf, size, addr, attr, allowOverwrite);
+    vol.writeFile(rkFileName, data.data(), data.size(), addr, attr, allowOverwrite);
     vol.saveImage();
 
     return true;
 }
 
 
+// "-" as targetFileName means standard output
 bool extractFile(const string& imageFileName, const string& rkFileName, const string& targetFileName)
 {
-    ofstream rkFile(targetFileName, ios::binary | std::fstream::trunc);
-    if (!rkFile.is_open()) {
-        cout << "error opening file " << rkFileName << endl;
-        return false;
+    ofstream file;
+    ostream rkFile(stdoutBuf);
+    if (targetFileName != "-") {
+        file.open(targetFileName, ios::binary | std::fstream::trunc);
+        if (!file.is_open()) {
+            cout << "error opening file " << rkFileName << endl;
+            return false;
+        }
+        rkFile.rdbuf(file.rdbuf());
     }
 
-    RkVolume vol(imageFileName, IFM_READ_ONLY);
+    RkVolume vol(imageFileName, IFM_READ_ONLY, overlayFileName);
 
     int size = 0;
     uint8_t* buf = vol.readFile(rkFileName, size);
 
     rkFile.write(reinterpret_cast<char*>(buf), size);
+    rkFile.flush();
     if (rkFile.rdstate()) {
         cout << "error writing file " << rkFileName << endl;
         delete[] buf;
         return false;
     }
-    rkFile.close();
 
     delete[] buf;
 
@@ -194,6 +351,551 @@ bool extractFile(const string& imageFileName, const string& rkFileName, const st
 }
 
 
+// Host files which are never copied to the image: hidden and backup files, disk images
+bool isWatchedFile(const string& fileName)
+{
+    if (fileName.empty() || fileName[0] == '.' || fileName.back() == '~')
+        return false;
+
+    string ext = fileName.substr(fileName.find_last_of('.') + 1);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext != "rdi";
+}
+
+
+bool fileExists(RkVolume& vol, string rkFileName)
+{
+    transform(rkFileName.begin(), rkFileName.end(), rkFileName.begin(), ::toupper);
+    auto fileList = vol.getFileList();
+    return find_if(fileList->begin(), fileList->end(), [&rkFileName](const RkFileInfo& fi) {return fi.fileName == rkFileName;}) != fileList->end();
+}
+
+
+// Writes changed host files to the image and deletes removed ones. The image is loaded and saved once,
+// files with the same contents are not rewritten.
+void syncFiles(const string& imageFileName, const vector<string>& changedFiles, const vector<string>& deletedFiles, uint16_t addr)
+{
+    RkVolume vol(imageFileName, IFM_READ_WRITE, overlayFileName);
+    bool modified = false;
+
+    for (const string& fileName: changedFiles) {
+        string fileNameWoPath = fileName.substr(fileName.find_last_of("/\\:") + 1);
+        if (!isWatchedFile(fileNameWoPath))
+            continue;
+
+        vector<uint8_t> data;
+        if (!loadHostFile(fileName, data)) {
+            cout << "error reading file " << fileName << endl;
+            continue;
+        }
+
+        string rkFileName = makeRkDosFileName(fileNameWoPath);
+        if (fileExists(vol, rkFileName)) {
+            int size = 0;
+            uint8_t* buf = vol.readFile(rkFileName, size);
+            bool same = size == (int)data.size() && equal(data.begin(), data.end(), buf);
+            delete[] buf;
+            if (same)
+                continue;
+        }
+
+        cout << "Writing file " << rkFileName << endl;
+        vol.writeFile(rkFileName, data.data(), data.size(), addr, 0, true);
+        modified = true;
+    }
+
+    for (const string& fileName: deletedFiles) {
+        string fileNameWoPath = fileName.substr(fileName.find_last_of("/\\:") + 1);
+        if (!isWatchedFile(fileNameWoPath))
+            continue;
+
+        string rkFileName = makeRkDosFileName(fileNameWoPath);
+        if (fileExists(vol, rkFileName)) {
+            cout << "Deleting file " << rkFileName << endl;
+            vol.deleteFile(rkFileName);
+            modified = true;
+        }
+    }
+
+    if (modified)
+        vol.saveImage();
+}
+
+
+// Imports programs from tape images: the format is recognized, the checksum is verified, load address
+// and internal name (or tape file name if there is none) are taken from the header. The image is loaded
+// and saved once. Files which can't be decoded, already exist or don't fit are skipped, other image
+// errors abort the whole import.
+bool importTapeFiles(const string& imageFileName, const vector<string>& tapeFileNames, bool readOnly, bool hidden, bool allowOverwrite, bool force)
+{
+    RkVolume vol(imageFileName, IFM_READ_WRITE, overlayFileName);
+
+    uint8_t attr = (readOnly ? 0x80 : 0) | (hidden ? 0x40 : 0);
+    int nImported = 0;
+
+    for (const string& tapeFileName: tapeFileNames) {
+        cout << tapeFileName << ": ";
+
+        vector<uint8_t> data;
+        if (!loadHostFile(tapeFileName, data)) {
+            cout << "file read error!" << endl;
+            continue;
+        }
+
+        string tapeFileNameWoPath = tapeFileName.substr(tapeFileName.find_last_of("/\\:") + 1);
+        size_t periodPos = tapeFileNameWoPath.find_last_of('.');
+        string ext = periodPos != string::npos ? tapeFileNameWoPath.substr(periodPos + 1) : "";
+
+        TapeFileFormat preferredFormat;
+        int nPreferredFormats = getFormatsByExt(ext, &preferredFormat);
+
+        TapeImageInfo info;
+        TapeDecodeResult res = decodeTape(data.data(), data.size(), info, &preferredFormat, nPreferredFormats);
+
+        if (res == TDR_UNKNOWN_FORMAT) {
+            cout << "unknown format!" << endl;
+            continue;
+        }
+
+        cout << txtFormats[info.format] << ", load " << setfill('0') << setw(4) << uppercase << hex << info.loadAddr;
+
+        if (res == TDR_BAD_CHECKSUM) {
+            cout << ", checksum error";
+            if (!force) {
+                cout << "!" << endl;
+                continue;
+            }
+        }
+
+        string baseName = info.intFileName.empty() ? tapeFileNameWoPath.substr(0, periodPos) : info.intFileName;
+        string rkFileName = makeRkDosFileName(baseName + ".bin");
+
+        cout << " -> " << rkFileName;
+
+        // these are detected before the image is changed, the file is skipped and files imported so far are kept
+        try {
+            vol.writeFile(rkFileName, const_cast<uint8_t*>(info.body), info.bodySize, info.loadAddr, attr, allowOverwrite);
+        }
+
+        catch (RkVolume::RkVolumeException& e) {
+            if (e.type == RkVolume::RkVolumeException::RVET_FILE_EXISTS)
+                cout << ", file already exists!" << endl;
+            else if (e.type == RkVolume::RkVolumeException::RVET_DISK_FULL)
+                cout << ", insufficient disk space!" << endl;
+            else
+                throw;
+            continue;
+        }
+
+        cout << endl;
+        ++nImported;
+    }
+
+    if (nImported)
+        vol.saveImage();
+
+    cout << endl << dec << nImported << " of " << tapeFileNames.size() << " file(s) imported" << endl;
+
+    return nImported == int(tapeFileNames.size());
+}
+
+
+// Directories are scanned for rdi files
+void addImageFiles(const string& name, vector<string>& fileNames)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) || !S_ISDIR(st.st_mode)) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    DIR* dir = opendir(name.c_str());
+    if (!dir) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    vector<string> dirFiles;
+    while (dirent* entry = readdir(dir)) {
+        string fileName = entry->d_name;
+        size_t periodPos = fileName.find_last_of('.');
+        string ext = periodPos != string::npos ? fileName.substr(periodPos + 1) : "";
+        transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == "rdi")
+            dirFiles.push_back(name + "/" + fileName);
+    }
+    closedir(dir);
+
+    sort(dirFiles.begin(), dirFiles.end());
+    fileNames.insert(fileNames.end(), dirFiles.begin(), dirFiles.end());
+}
+
+
+bool updateCatalog(const string& catalogFileName, const vector<string>& names, int nThreads)
+{
+    RkCatalog catalog;
+    if (!catalog.load(catalogFileName)) {
+        cout << "Bad catalog file " << catalogFileName << "!" << endl;
+        return false;
+    }
+
+    vector<string> imageFileNames;
+    for (const string& name: names)
+        addImageFiles(name, imageFileNames);
+
+    int nErrors;
+    int nScanned = catalog.update(imageFileNames, nThreads, cout, nErrors);
+
+    if (!catalog.save(catalogFileName)) {
+        cout << "Error writing " << catalogFileName << "!" << endl;
+        return false;
+    }
+
+    cout << endl << catalog.getImages().size() << " image(s), " << catalog.getFiles().size() << " file(s) in catalog, "
+         << nScanned << " image(s) scanned";
+    if (nErrors)
+        cout << ", " << nErrors << " error(s)";
+    cout << "." << endl;
+
+    return !nErrors;
+}
+
+
+bool queryCatalog(const string& catalogFileName, const string& query, bool byHash)
+{
+    RkCatalog catalog;
+    if (!catalog.load(catalogFileName) || catalog.getImages().empty()) {
+        cout << "Bad catalog file " << catalogFileName << "!" << endl;
+        return false;
+    }
+
+    vector<const RkCatalogFile*> files;
+    if (byHash) {
+        char* numEnd;
+        uint64_t hash = strtoull(query.c_str(), &numEnd, 16);
+        if (*numEnd || query.empty()) {
+            cout << "Invalid hash!" << endl;
+            return false;
+        }
+        files = catalog.findByHash(hash);
+    } else
+        files = catalog.findByName(query);
+
+    cout << "Name          " << "\t" << "Addr" << "\t" << "  Bytes" << "\t" << "  Attr" << "\t" << "Hash            " << "\t" << "Image" << endl;
+    cout << "----          " << "\t" << "----" << "\t" << "  -----" << "\t" << "  ----" << "\t" << "----            " << "\t" << "-----" << endl;
+
+    for (const RkCatalogFile* file: files) {
+        cout << left << setw(14) << setfill(' ') << string(file->fileName, strnlen(file->fileName, sizeof(file->fileName))) << "\t"
+             << right << setw(4) << setfill('0') << hex << file->addr << "\t"
+             << setw(7) << setfill(' ') << dec << file->size << "\t"
+             << setw(6) << getAttrString(file->attr) << "\t"
+             << setw(16) << setfill('0') << hex << file->hash << "\t"
+             << catalog.getImages()[file->image].fileName << endl;
+    }
+
+    cout << endl << dec << files.size() << " file(s) found" << endl;
+
+    return !files.empty();
+}
+
+
+// Searches all images in parallel, the file content is scanned in sector buffers
+bool searchImages(const vector<string>& names, const vector<string>& patterns, const vector<string>& patternNames, int nThreads)
+{
+    vector<string> imageFileNames;
+    for (const string& name: names)
+        addImageFiles(name, imageFileNames);
+
+    cout << "Image\tName          \tOffset\tAddr\tPattern" << endl;
+    cout << "-----\t----          \t------\t----\t-------" << endl;
+
+    mutex coutMutex;
+    int nMatches = 0;
+    int nErrors = 0;
+
+    runParallel(imageFileNames.size(), [&](int n) {
+        const string& imageFileName = imageFileNames[n];
+        ostringstream log;
+        int nImageMatches = 0;
+        bool ok = true;
+
+        try {
+            RkVolume vol(imageFileName, IFM_READ_ONLY);
+            if (!vol.isValid())
+                throw RkVolume::RkVolumeException {RkVolume::RkVolumeException::RVET_BAD_DISK_FORMAT};
+
+            SectorSearch search(patterns);
+            vector<SearchMatch> matches;
+
+            for (const RkFileInfo& fi: *vol.getFileList()) {
+                search.reset();
+                matches.clear();
+
+                int bytesLeft = fi.fileSize;
+                for (const RkFileSector& sector: vol.getFileSectors(fi)) {
+                    if (sector.size <= bytesLeft) {
+                        search.feed(sector.data, sector.size, matches);
+                        bytesLeft -= sector.size;
+                    }
+                }
+
+                sort(matches.begin(), matches.end(), [](const SearchMatch& x, const SearchMatch& y) {
+                    return x.offset < y.offset || (x.offset == y.offset && x.pattern < y.pattern);
+                });
+
+                for (const SearchMatch& match: matches)
+                    log << imageFileName << "\t" << left << setw(14) << setfill(' ') << fi.fileName << "\t"
+                        << right << setw(6) << setfill('0') << hex << uppercase << match.offset << "\t"
+                        << setw(4) << ((fi.addr + match.offset) & 0xFFFF) << "\t" << patternNames[match.pattern] << endl;
+                nImageMatches += matches.size();
+            }
+        }
+
+        catch (RkVolume::RkVolumeException&) {
+            log << imageFileName << ": bad disk image!" << endl;
+            ok = false;
+        }
+
+        catch (ImageFileException&) {
+            log << imageFileName << ": file read error!" << endl;
+            ok = false;
+        }
+
+        lock_guard<mutex> lock(coutMutex);
+        nMatches += nImageMatches;
+        if (!ok)
+            ++nErrors;
+        cout << log.str();
+    }, nThreads);
+
+    cout << endl << dec << nMatches << " match(es) in " << imageFileNames.size() << " image(s)";
+    if (nErrors)
+        cout << ", " << nErrors << " error(s)";
+    cout << "." << endl;
+
+    return nMatches && !nErrors;
+}
+
+
+bool putImagesToStore(const string& storeDirName, const vector<string>& names, int nThreads)
+{
+    RkStore store(storeDirName);
+    if (!store.init()) {
+        cout << "Can't create store " << storeDirName << "!" << endl;
+        return false;
+    }
+
+    vector<string> imageFileNames;
+    for (const string& name: names)
+        addImageFiles(name, imageFileNames);
+
+    mutex coutMutex;
+    int nErrors = 0;
+
+    runParallel(imageFileNames.size(), [&](int n) {
+        ostringstream log;
+        bool ok = store.addImage(imageFileNames[n], log);
+
+        lock_guard<mutex> lock(coutMutex);
+        if (!ok)
+            ++nErrors;
+        cout << log.str();
+    }, nThreads);
+
+    RkStore::Stats stats = store.getStats();
+
+    cout << endl << stats.nImages << " image(s), " << stats.imageBytes << " bytes" << endl;
+    cout << stats.nFiles << " file(s), " << stats.fileBytes << " bytes, " << stats.nUniqueFiles << " distinct file(s), "
+         << stats.uniqueFileBytes << " bytes" << endl;
+    cout << "Objects referenced: " << stats.objectBytes << " bytes";
+    if (stats.imageBytes)
+        cout << " (" << stats.objectBytes * 100 / stats.imageBytes << "% of image size, "
+             << int64_t(stats.imageBytes - stats.objectBytes) << " bytes saved)";
+    cout << ", " << stats.newObjectBytes << " bytes added to store" << endl;
+    if (nErrors)
+        cout << nErrors << " error(s)" << endl;
+
+    return !nErrors;
+}
+
+
+bool unpackImageFromStore(const string& storeDirName, const string& imageName, const string& targetFileName)
+{
+    RkStore store(storeDirName);
+
+    vector<uint8_t> data;
+    if (!store.rebuildImage(imageName, data, cout))
+        return false;
+
+    if (!saveHostFile(targetFileName, data.data(), data.size())) {
+        cout << "error writing file " << targetFileName << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool compareImages(const string& imageFileName, const string& newImageFileName, const string& patchFileName)
+{
+    RkImageDiff diff;
+    vector<uint8_t> patch;
+    diffImages(imageFileName, newImageFileName, diff, patch);
+
+    if (diff.fileSystems) {
+        for (const string& fileName: diff.addedFiles)
+            cout << "+ " << fileName << endl;
+        for (const string& fileName: diff.removedFiles)
+            cout << "- " << fileName << endl;
+        for (const string& fileName: diff.changedFiles)
+            cout << "* " << fileName << endl;
+        cout << endl << diff.addedFiles.size() << " file(s) added, " << diff.removedFiles.size() << " removed, "
+             << diff.changedFiles.size() << " changed" << endl;
+    } else
+        cout << "No file system on image, files are not compared" << endl;
+
+    cout << diff.nChangedSectors << " sector(s) changed";
+    if (diff.nChangedTracks)
+        cout << ", " << diff.nChangedTracks << " track(s) changed outside of sectors";
+    cout << endl;
+
+    if (!patchFileName.empty()) {
+        if (!saveHostFile(patchFileName, patch.data(), patch.size())) {
+            cout << "error writing file " << patchFileName << endl;
+            return false;
+        }
+        cout << "Patch " << patchFileName << ": " << patch.size() << " bytes" << endl;
+    }
+
+    return true;
+}
+
+
+// Takes the hash tree stored next to the image if it's up to date, otherwise the tree is computed
+// and stored if write is set
+bool getImageHashTree(const string& imageFileName, RkHashTree& tree, bool write)
+{
+    // the stamp is taken before the image is read, so a tree of an image changed meanwhile is rebuilt next time
+    FileStamp stamp;
+    if (!getFileStamp(imageFileName, stamp)) {
+        cout << "error reading file " << imageFileName << endl;
+        return false;
+    }
+
+    string treeFileName = imageFileName + ".rkh";
+    if (tree.load(treeFileName, stamp)) {
+        cout << imageFileName << ": " << setw(16) << setfill('0') << hex << tree.root << dec << " (stored)" << endl;
+        return true;
+    }
+
+    RkVolume vol(imageFileName, IFM_READ_ONLY);
+    vol.getHashTree(tree);
+    cout << imageFileName << ": " << setw(16) << setfill('0') << hex << tree.root << dec << endl;
+
+    if (write && !tree.save(treeFileName, stamp)) {
+        cout << "error writing file " << treeFileName << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+// Compares root hashes, changed sectors and files are found by descending the trees
+bool compareHashTrees(const string& imageFileName, const string& newImageFileName, bool write)
+{
+    RkHashTree tree, newTree;
+    if (!getImageHashTree(imageFileName, tree, write))
+        return false;
+    if (newImageFileName.empty())
+        return true;
+    if (!getImageHashTree(newImageFileName, newTree, write))
+        return false;
+
+    cout << endl;
+    if (tree.root == newTree.root) {
+        cout << "Images are identical" << endl;
+        return true;
+    }
+
+    if (tree.fileSystem && newTree.fileSystem) {
+        vector<string> addedFiles, removedFiles, changedFiles;
+        tree.compareFiles(newTree, addedFiles, removedFiles, changedFiles);
+        for (const string& fileName: addedFiles)
+            cout << "+ " << fileName << endl;
+        for (const string& fileName: removedFiles)
+            cout << "- " << fileName << endl;
+        for (const string& fileName: changedFiles)
+            cout << "* " << fileName << endl;
+        cout << endl << addedFiles.size() << " file(s) added, " << removedFiles.size() << " removed, "
+             << changedFiles.size() << " changed" << endl;
+    } else
+        cout << "No file system on image, files are not compared" << endl;
+
+    vector<pair<int, int>> changedSectors;
+    tree.compare(newTree, changedSectors);
+    cout << changedSectors.size() << " sector(s) changed" << endl;
+
+    return true;
+}
+
+
+bool applyImagePatch(const string& imageFileName, const string& patchFileName, const string& targetFileName)
+{
+    vector<uint8_t> patch;
+    if (!loadHostFile(patchFileName, patch)) {
+        cout << "error reading file " << patchFileName << endl;
+        return false;
+    }
+
+    // the image is updated in place or written to a new file
+    ImageFile image(imageFileName, targetFileName.empty() ? IFM_READ_WRITE : IFM_READ_ONLY);
+
+    vector<pair<size_t, size_t>> changedRanges;
+    switch (applyPatch(image.getData(), image.getSize(), patch, changedRanges)) {
+    case PR_OK:
+        break;
+    case PR_BAD_PATCH:
+        cout << "bad patch file!" << endl;
+        return false;
+    case PR_WRONG_IMAGE:
+        cout << "patch doesn't match the image!" << endl;
+        return false;
+    case PR_CHECKSUM_ERROR:
+        cout << "checksum error!" << endl;
+        return false;
+    }
+
+    if (targetFileName.empty()) {
+        for (const auto& range: changedRanges)
+            image.update(range.first, range.second);
+    } else if (!saveHostFile(targetFileName, image.getData(), image.getSize())) {
+        cout << "error writing file " << targetFileName << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+// Writes the image to targetFileName packed or unpacked, the source may be either,
+// returns sizes of both files
+void packImage(const string& imageFileName, const string& targetFileName, bool unpack, size_t& imageFileSize, size_t& targetFileSize)
+{
+    {
+        ImageFile image(imageFileName, IFM_READ_ONLY);
+        ImageFile target(targetFileName, IFM_WRITE_CREATE, image.getSize());
+        memcpy(target.getData(), image.getData(), image.getSize());
+        target.setPacked(!unpack);
+        target.updateAll();
+    }
+
+    struct stat st;
+    imageFileSize = stat(imageFileName.c_str(), &st) ? 0 : st.st_size;
+    targetFileSize = stat(targetFileName.c_str(), &st) ? 0 : st.st_size;
+}
+
+
 void formatImage(const string& imageFileName, int directorySize)
 {
     RkVolume vol(imageFileName, IFM_WRITE_CREATE);
@@ -202,8 +904,124 @@ void formatImage(const string& imageFileName, int directorySize)
 }
 
 
+void printVolumeError(const RkVolume::RkVolumeException& e)
+{
+    cout << "image error: ";
+    switch (e.type) {
+    case RkVolume::RkVolumeException::RVET_SECTOR_NOT_FOUND:
+        cout << "sector not found! Track " << e.track << ", sector " << e.sector << "." << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_DISK_FULL:
+        cout << "insufficient disk space!" << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_DIR_FULL:
+        cout << "No more dir entries!" << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_BAD_DISK_FORMAT:
+        cout << "bad disk image!" << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_NO_FILESYSTEM:
+        cout << "no filesyetem on image!" << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_FILE_NOT_FOUND:
+        cout << "file not found!" << endl;
+        break;
+    case RkVolume::RkVolumeException::RVET_FILE_EXISTS:
+        cout << "file already exists!" << endl;
+        break;
+    default:
+        cout << "unknown error!" << endl;
+    }
+}
+
+
+void printImageFileError(ImageFileException e)
+{
+    cout << endl << "Disk error: ";
+    switch (e) {
+    case IFE_OPEN_ERROR:
+        cout << "file open error!" << endl;
+        break;
+    case IFE_READ_ERROR:
+        cout << "file read error!" << endl;
+        break;
+    case IFE_WRITE_ERROR:
+        cout << "file write error!" << endl;
+        break;
+    case IFE_OVERLAY_MISMATCH:
+        cout << "overlay file doesn't match the image!" << endl;
+        break;
+    }
+}
+
+
+// Keeps the image in sync with a host directory until interrupted
+int watchDirectory(const string& imageFileName, const string& dirName, uint16_t addr)
+{
+    FileWatcher watcher;
+    if (!watcher.isValid()) {
+        cout << "Watch mode is not supported on this platform!" << endl;
+        return 1;
+    }
+
+    if (!watcher.addDir(dirName)) {
+        cout << "Can't watch directory " << dirName << "!" << endl;
+        return 1;
+    }
+
+    // initial sync: all regular files in the directory
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        cout << "Can't open directory " << dirName << "!" << endl;
+        return 1;
+    }
+
+    vector<string> changedFiles, deletedFiles;
+    while (dirent* entry = readdir(dir)) {
+        string fileName = dirName + "/" + entry->d_name;
+        struct stat st;
+        if (!stat(fileName.c_str(), &st) && S_ISREG(st.st_mode))
+            changedFiles.push_back(fileName);
+    }
+    closedir(dir);
+    sort(changedFiles.begin(), changedFiles.end());
+
+    cout << "Synchronizing image " << imageFileName << " with directory " << dirName << endl;
+
+    for (;;) {
+        try {
+            syncFiles(imageFileName, changedFiles, deletedFiles, addr);
+        }
+
+        catch (RkVolume::RkVolumeException& e) {
+            printVolumeError(e);
+        }
+
+        catch (ImageFileException& e) {
+            printImageFileError(e);
+            return 1;
+        }
+
+        cout << "Watching for changes..." << endl;
+
+        if (!watcher.wait(changedFiles, deletedFiles, 100))
+            return 1;
+    }
+}
+
+
 int main(int argc, const char** argv)
 {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    // standard output may be used for file data, messages go to stderr in this case
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "-")
+            cout.rdbuf(cerr.rdbuf());
+
     cout << "rkdisk v. " VERSION " (c) Viktor Pykhonin, 2024" << endl << endl;
     string moduleName = argv[0];
     moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
@@ -217,8 +1035,17 @@ int main(int argc, const char** argv)
     bool readOnly = false;
     bool hidden = false;
     bool noConfirmation = false;
+    bool force = false;
     uint16_t startingAddr = 0;
     int directorySize = 4;
+    int nThreads = 0;
+    bool queryByHash = false;
+    bool discardOverlay = false;
+    bool writeHashTrees = false;
+    bool unpack = false;
+    vector<string> fileNames;
+    vector<string> patterns;
+    vector<string> patternNames;
 
     // parse command line
 
@@ -235,14 +1062,14 @@ int main(int argc, const char** argv)
         option = argv[i];
 
         if (option == "-o") {
-            if (i > argc || command != "a") {
+            if (i > argc || (command != "a" && command != "i")) {
                 usage(moduleName);
                 return 1;
             }
             allowOverwrite = true;
         } else if (option == "-a") {
             ++i;
-            if (i > argc || command != "a") {
+            if (i > argc || (command != "a" && command != "w")) {
                 usage(moduleName);
                 return 1;
             }
@@ -270,12 +1097,86 @@ int main(int argc, const char** argv)
                 usage(moduleName);
                 return 1;
             }
+        } else if (option == "-j") {
+            ++i;
+            if (i >= argc || (command != "c" && command != "s" && command != "p")) {
+                usage(moduleName);
+                return 1;
+            }
+            value = argv[i];
+
+            char* numEnd;
+            nThreads = strtoul(value.c_str(), &numEnd, 10);
+            if (*numEnd) {
+                cout << "Invalid number of threads!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+        } else if (option == "-t" || option == "-x") {
+            ++i;
+            if (i >= argc || command != "s") {
+                usage(moduleName);
+                return 1;
+            }
+            value = argv[i];
+
+            string pattern = value;
+            if (option == "-x" && !parseHexPattern(value, pattern)) {
+                cout << "Invalid hex string!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            if (pattern.empty()) {
+                cout << "Empty search string!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            patterns.push_back(pattern);
+            patternNames.push_back(option == "-t" ? "\"" + value + "\"" : value);
+        } else if (option == "-v") {
+            ++i;
+            if (i >= argc || (command != "a" && command != "x" && command != "d" && command != "l" && command != "t" &&
+                              command != "i" && command != "w")) {
+                usage(moduleName);
+                return 1;
+            }
+            overlayFileName = argv[i];
+        } else if (option == "-d") {
+            if (command != "o") {
+                usage(moduleName);
+                return 1;
+            }
+            discardOverlay = true;
+        } else if (option == "-u") {
+            if (command != "z") {
+                usage(moduleName);
+                return 1;
+            }
+            unpack = true;
+        } else if (option == "-w") {
+            if (command != "h") {
+                usage(moduleName);
+                return 1;
+            }
+            writeHashTrees = true;
+        } else if (option == "-c") {
+            if (command != "q") {
+                usage(moduleName);
+                return 1;
+            }
+            queryByHash = true;
         } else if (option == "-b") {
             if (i > argc || command != "l") {
                 usage(moduleName);
                 return 1;
             }
             briefListing = true;
+        } else if (option == "-f") {
+            if (i > argc || command != "i") {
+                usage(moduleName);
+                return 1;
+            }
+            force = true;
         } else if (option == "-y") {
             if (i > argc || command != "f") {
                 usage(moduleName);
@@ -283,26 +1184,30 @@ int main(int argc, const char** argv)
             }
             noConfirmation = true;
         } else if (option == "-r") {
-            if (i > argc || (command != "a" && command != "t")) {
+            if (i > argc || (command != "a" && command != "t" && command != "i")) {
                 usage(moduleName);
                 return 1;
             }
             readOnly = true;
         } else if (option == "-h") {
-            if (i > argc || (command != "a" && command != "t")) {
+            if (i > argc || (command != "a" && command != "t" && command != "i")) {
                 usage(moduleName);
                 return 1;
             }
             hidden = true;
         } else {
-            if (option[0] == '-') {
+            if (option[0] == '-' && option != "-") {
                 cout << "Invalid option:" << option << endl << endl;
                 usage(moduleName);
                 return 1;
             }
 
-            if (imageFileName.empty()) {
+            if (command == "s") {
+                fileNames.push_back(option);
+            } else if (imageFileName.empty()) {
                 imageFileName = option;
+            } else if (command == "i" || command == "c" || command == "p") {
+                fileNames.push_back(option);
             } else if (rkFileName.empty()) {
                 rkFileName = option;
             } else if (targetFileName.empty()) {
@@ -316,12 +1221,29 @@ int main(int argc, const char** argv)
         ++i;
     }
 
-    if (command != "a" && command != "x" && command != "d" && command != "l" && command != "f" && command != "t") {
+    if (command != "a" && command != "x" && command != "d" && command != "l" && command != "f" && command != "t" && command != "w" && command != "i" &&
+        command != "c" && command != "q" && command != "s" && command != "p" && command != "u" &&
+        command != "e" && command != "y" && command != "o" && command != "h" && command != "z") {
         cout << "Unknown comamnd \"" << command << "\"" << endl << endl;
         usage(moduleName);
         return 1;
     }
 
+    if (command == "s") {
+        if (patterns.empty()) {
+            cout << "No search string specified!" << endl << endl;
+            usage(moduleName);
+            return 1;
+        }
+        if (fileNames.empty()) {
+            cout << "No image file name specified!" << endl << endl;
+            usage(moduleName);
+            return 1;
+        }
+        cout << "Searching images:" << endl << endl;
+        return searchImages(fileNames, patterns, patternNames, nThreads) ? 0 : 1;
+    }
+
     if (imageFileName.empty()) {
         cout << "No image file name specified!" << endl << endl;
         usage(moduleName);
@@ -357,6 +1279,37 @@ int main(int argc, const char** argv)
             formatImage(imageFileName, directorySize);
             cout << "done." << endl;
             return 0;
+        } else if (command == "i") {
+            if (fileNames.empty()) {
+                cout << "No tape file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            cout << "Importing tape files to image " << imageFileName << ":" << endl << endl;
+            return importTapeFiles(imageFileName, fileNames, readOnly, hidden, allowOverwrite, force) ? 0 : 1;
+        } else if (command == "c") {
+            if (fileNames.empty()) {
+                cout << "No image file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            cout << "Updating catalog " << imageFileName << ":" << endl << endl;
+            return updateCatalog(imageFileName, fileNames, nThreads) ? 0 : 1;
+        } else if (command == "p") {
+            if (fileNames.empty()) {
+                cout << "No image file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            cout << "Putting images to store " << imageFileName << ":" << endl << endl;
+            return putImagesToStore(imageFileName, fileNames, nThreads) ? 0 : 1;
+        } else if (command == "h") {
+            if (!targetFileName.empty()) {
+                cout << "Extra file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            return compareHashTrees(imageFileName, rkFileName, writeHashTrees) ? 0 : 1;
         }
 
         if (rkFileName.empty()) {
@@ -365,6 +1318,75 @@ int main(int argc, const char** argv)
             return 1;
         }
 
+        if (command == "q") {
+            if (!targetFileName.empty()) {
+                cout << "Extra file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            return queryCatalog(imageFileName, rkFileName, queryByHash) ? 0 : 1;
+        }
+
+        if (command == "e") {
+            cout << "Comparing image " << imageFileName << " with " << rkFileName << ":" << endl << endl;
+            return compareImages(imageFileName, rkFileName, targetFileName) ? 0 : 1;
+        }
+
+        if (command == "y") {
+            cout << "Applying patch " << rkFileName << " to image " << imageFileName << " ... ";
+            if (!applyImagePatch(imageFileName, rkFileName, targetFileName))
+                return 1;
+            cout << "done." << endl;
+            return 0;
+        }
+
+        if (command == "z") {
+            if (!targetFileName.empty()) {
+                cout << "Extra file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            cout << (unpack ? "Unpacking image " : "Packing image ") << imageFileName << " to " << rkFileName << " ... ";
+            size_t imageFileSize, targetFileSize;
+            packImage(imageFileName, rkFileName, unpack, imageFileSize, targetFileSize);
+            cout << "done, " << imageFileSize << " -> " << targetFileSize << " bytes." << endl;
+            return 0;
+        }
+
+        if (command == "o") {
+            if (!targetFileName.empty()) {
+                cout << "Extra file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            if (discardOverlay)
+                cout << "Discarding overlay " << rkFileName << " of image " << imageFileName << " ... ";
+            else
+                cout << "Committing overlay " << rkFileName << " to image " << imageFileName << " ... ";
+            commitOverlay(imageFileName, rkFileName, discardOverlay);
+            cout << "done." << endl;
+            return 0;
+        }
+
+        if (command == "u") {
+            if (targetFileName.empty())
+                targetFileName = rkFileName.substr(rkFileName.find_last_of("/\\:") + 1);
+            cout << "Unpacking image " << rkFileName << " from store " << imageFileName << " to " << targetFileName << " ... ";
+            if (!unpackImageFromStore(imageFileName, rkFileName, targetFileName))
+                return 1;
+            cout << "done." << endl;
+            return 0;
+        }
+
+        if (command == "w") {
+            if (!targetFileName.empty()) {
+                cout << "Extra file name specified!" << endl << endl;
+                usage(moduleName);
+                return 1;
+            }
+            return watchDirectory(imageFileName, rkFileName, startingAddr);
+        }
+
         if (command == "x") {
             if (targetFileName.empty())
                 targetFileName = rkFileName;
@@ -372,17 +1394,19 @@ int main(int argc, const char** argv)
             if (!extractFile(imageFileName, rkFileName, targetFileName))
                 return 1;
         } else if (command == "a") {
-            if (!targetFileName.empty()) {
-                cout << "Extra file name specified!" << endl << endl;
+            // target file name is the name in the image, it's required for standard input
+            if (rkFileName == "-" && targetFileName.empty()) {
+                cout << "No target file name specified!" << endl << endl;
                 usage(moduleName);
                 return 1;
             }
-            string rkFileNameWoPath = rkFileName.substr(rkFileName.find_last_of("/\\:") + 1);
+            string rkFileNameWoPath = targetFileName.empty() ? rkFileName.substr(rkFileName.find_last_of("/\\:") + 1) : targetFileName;
             string newRkFileName = makeRkDosFileName(rkFileNameWoPath);
             if (rkFileNameWoPath != newRkFileName)
                 cout << "New rk file name: " << newRkFileName << endl;
             cout << "Adding file " << rkFileNameWoPath << " to image " << imageFileName << " ... ";
-            addFile(imageFileName, newRkFileName, startingAddr, readOnly, hidden, allowOverwrite);
+            if (!addFile(imageFileName, newRkFileName, rkFileName, startingAddr, readOnly, hidden, allowOverwrite))
+                return 1;
         } else if (command == "d") {
             if (!targetFileName.empty()) {
                 cout << "Extra file name specified!" << endl << endl;
@@ -407,47 +1431,11 @@ int main(int argc, const char** argv)
     }
 
     catch (RkVolume::RkVolumeException& e) {
-        cout << "image error: ";
-        switch (e.type) {
-        case RkVolume::RkVolumeException::RVET_SECTOR_NOT_FOUND:
-            cout << "sector not found! Track " << e.track << ", sector " << e.sector << "." << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_DISK_FULL:
-            cout << "insufficient disk space!" << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_DIR_FULL:
-            cout << "No more dir entries!" << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_BAD_DISK_FORMAT:
-            cout << "bad disk image!" << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_NO_FILESYSTEM:
-            cout << "no filesyetem on image!" << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_FILE_NOT_FOUND:
-            cout << "file not found!" << endl;
-            break;
-        case RkVolume::RkVolumeException::RVET_FILE_EXISTS:
-            cout << "file already exists!" << endl;
-            break;
-        default:
-            cout << "unknown error!" << endl;
-        }
+        printVolumeError(e);
     }
 
     catch (ImageFileException& e) {
-        cout << endl << "Disk error: ";
-        switch (e) {
-        case IFE_OPEN_ERROR:
-            cout << "file open error!" << endl;
-            break;
-        case IFE_READ_ERROR:
-            cout << "file read error!" << endl;
-            break;
-        case IFE_WRITE_ERROR:
-            cout << "file write error!" << endl;
-            break;
-        }
+        printImageFileError(e);
     }
 
     return 1;
@@ -5,13 +5,36 @@ CONFIG -= qt
 
 SOURCES += \
     rkdisk.cpp \
+    rkcatalog.cpp \
+    rksearch.cpp \
+    rkstore.cpp \
+    rkpatch.cpp \
     rkimage/imagefile.cpp \
+    rkimage/rkhashtree.cpp \
     rkimage/rkvolume.cpp \
-    rkimage/volume.cpp
+    rkimage/trackcodec.cpp \
+    rkimage/volume.cpp \
+    ../common/filewatcher.cpp \
+    ../bin2tape/tapedecoder.cpp \
+    ../bin2tape/tapeencoder.cpp
 
 HEADERS += \
+    rkcatalog.h \
+    rksearch.h \
+    rkstore.h \
+    rkpatch.h \
     rkimage/imagefile.h \
+    rkimage/rkhashtree.h \
     rkimage/rkvolume.h \
-    rkimage/volume.h
+    rkimage/trackcodec.h \
+    rkimage/volume.h \
+    ../common/filewatcher.h \
+    ../bin2tape/tapedecoder.h \
+    ../bin2tape/tapeencoder.h \
+    ../common/filestamp.h \
+    ../common/hash.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
 
 QMAKE_LFLAGS += -static -static-libgcc
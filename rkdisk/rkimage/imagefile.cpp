@@ -17,14 +17,62 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #include <cstring>
+#include <cstdio>
 
 #include "imagefile.h"
+#include "trackcodec.h"
+#include "../../common/hash.h"
 
 using namespace std;
 
 
+#pragma pack(push, 1)
+
+// overlay file: header followed by slots, each slot is a block number and block data
+struct OverlayHeader {
+    char magic[4];      // "RKOV"
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t blockSize;
+    uint32_t imageSize;
+    uint64_t baseHash;  // hash of the base image the overlay was made for
+};
+
+// packed image: header followed by the track index and packed tracks
+struct PackedHeader {
+    char magic[4];      // "RKDZ"
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t imageSize;
+    uint32_t trackSize;
+    uint32_t nTracks;
+};
+
+struct PackedIndexEntry {
+    uint32_t offset;
+    uint32_t size;      // equals track size if the track is stored as is
+    uint32_t capacity;  // a repacked track is rewritten in place if it fits
+};
+
+#pragma pack(pop)
+
+static const char c_packedMagic[4] = {'R', 'K', 'D', 'Z'};
+static const uint16_t c_packedVersion = 1;
+
+// RK DOS track, other images are split into blocks of the same size
+static const uint32_t c_packedTrackSize = 3125;
+
+static const char c_overlayMagic[4] = {'R', 'K', 'O', 'V'};
+static const uint16_t c_overlayVersion = 2;
+
+// one sector, RK DOS sector records are written by one or two blocks
+static const uint32_t c_overlayBlockSize = 512;
+
+
 ImageFile::ImageFile(const string& fileName, ImageFileMode mode, int imageSize)
 {
     m_mode = mode;
@@ -39,6 +87,9 @@ ImageFile::ImageFile(const string& fileName, ImageFileMode mode, int imageSize)
     case IFM_WRITE_CREATE:
         openMode = ios::binary | ios::out | std::fstream::trunc;
         break;
+    case IFM_OVERLAY:
+        // overlay constructor should be used
+        throw IFE_OPEN_ERROR;
     }
 
     m_file.open(fileName, openMode);
@@ -47,15 +98,7 @@ ImageFile::ImageFile(const string& fileName, ImageFileMode mode, int imageSize)
 
     if (mode != IFM_WRITE_CREATE) {
         // open existing file
-        m_file.seekg(0, ios::end);
-        m_size = m_file.tellg();
-        m_file.seekg(0, ios::beg);
-        m_buf = new uint8_t[m_size];
-        m_file.read((char*)(m_buf), m_size);
-        if (m_file.rdstate()) {
-            throw IFE_READ_ERROR;
-            m_file.close();
-        }
+        readImage();
     } else {
         // create new file
         m_buf = new uint8_t[imageSize];
@@ -65,10 +108,338 @@ ImageFile::ImageFile(const string& fileName, ImageFileMode mode, int imageSize)
 }
 
 
+ImageFile::ImageFile(const string& baseFileName, const string& overlayFileName)
+{
+    m_mode = IFM_OVERLAY;
+    m_fileName = baseFileName;
+    m_overlayFileName = overlayFileName;
+
+    m_file.open(baseFileName, ios::binary | ios::in);
+    if (!m_file.is_open())
+        throw IFE_OPEN_ERROR;
+
+    readImage();
+
+    m_baseBlockHashes.resize((m_size + c_overlayBlockSize - 1) / c_overlayBlockSize);
+    for (size_t i = 0; i < m_baseBlockHashes.size(); i++) {
+        size_t offset = i * c_overlayBlockSize;
+        m_baseBlockHashes[i] = hash64(m_buf + offset, min((size_t)c_overlayBlockSize, m_size - offset));
+    }
+    m_baseHash = hash64(m_baseBlockHashes.data(), m_baseBlockHashes.size() * sizeof(uint64_t));
+
+    readOverlay();
+}
+
+
 ImageFile::~ImageFile()
 {
     if (m_file)
         m_file.close();
+    if (m_overlay.is_open())
+        m_overlay.close();
+}
+
+
+// the buffer is kept if the size is the same, so pointers to image data stay valid
+void ImageFile::allocBuffer(size_t size)
+{
+    if (!m_buf || size != m_size) {
+        delete[] m_buf;
+        m_buf = new uint8_t[size];
+        m_size = size;
+    }
+}
+
+
+// reads raw or packed image
+void ImageFile::readImage()
+{
+    m_file.clear();
+    m_file.seekg(0, ios::end);
+    size_t fileSize = m_file.tellg();
+    m_file.seekg(0, ios::beg);
+
+    char magic[sizeof(c_packedMagic)] = {};
+    if (fileSize >= sizeof(PackedHeader))
+        m_file.read(magic, sizeof(magic));
+    m_file.seekg(0, ios::beg);
+
+    if (!memcmp(magic, c_packedMagic, sizeof(magic))) {
+        vector<uint8_t> file(fileSize);
+        m_file.read((char*)file.data(), fileSize);
+        if (m_file.rdstate())
+            throw IFE_READ_ERROR;
+        readPacked(file);
+        return;
+    }
+
+    allocBuffer(fileSize);
+    m_file.read((char*)(m_buf), m_size);
+    if (m_file.rdstate())
+        throw IFE_READ_ERROR;
+}
+
+
+void ImageFile::readPacked(const vector<uint8_t>& file)
+{
+    PackedHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.version != c_packedVersion || !header.trackSize ||
+            header.nTracks != (header.imageSize + header.trackSize - 1) / header.trackSize ||
+            sizeof(header) + (size_t)header.nTracks * sizeof(PackedIndexEntry) > file.size())
+        throw IFE_READ_ERROR;
+
+    allocBuffer(header.imageSize);
+    m_packed = true;
+    m_trackSize = header.trackSize;
+    m_tracks.resize(header.nTracks);
+    m_packedFileEnd = sizeof(header) + header.nTracks * sizeof(PackedIndexEntry);
+
+    const PackedIndexEntry* index = (const PackedIndexEntry*)(file.data() + sizeof(header));
+    for (uint32_t t = 0; t < header.nTracks; t++) {
+        PackedIndexEntry entry;
+        memcpy(&entry, index + t, sizeof(entry));
+
+        size_t offset = (size_t)t * m_trackSize;
+        size_t len = min((size_t)m_trackSize, m_size - offset);
+        if (entry.size > entry.capacity || (size_t)entry.offset + entry.capacity > file.size())
+            throw IFE_READ_ERROR;
+
+        if (entry.size == len)
+            memcpy(m_buf + offset, file.data() + entry.offset, len);
+        else if (!unpackTrack(file.data() + entry.offset, entry.size, m_buf + offset, len))
+            throw IFE_READ_ERROR;
+
+        m_tracks[t] = {entry.offset, entry.size, entry.capacity, hash64(m_buf + offset, len)};
+        m_packedFileEnd = max(m_packedFileEnd, entry.offset + entry.capacity);
+    }
+}
+
+
+// writes the whole packed image, used for new images
+void ImageFile::writePacked()
+{
+    uint32_t nTracks = (m_size + m_trackSize - 1) / m_trackSize;
+    vector<uint8_t> file(sizeof(PackedHeader) + nTracks * sizeof(PackedIndexEntry));
+    vector<PackedIndexEntry> index(nTracks);
+    m_tracks.resize(nTracks);
+
+    vector<uint8_t> packed;
+    for (uint32_t t = 0; t < nTracks; t++) {
+        size_t offset = (size_t)t * m_trackSize;
+        size_t len = min((size_t)m_trackSize, m_size - offset);
+
+        packTrack(m_buf + offset, len, packed);
+        if (packed.size() >= len)
+            packed.assign(m_buf + offset, m_buf + offset + len);
+
+        index[t] = {(uint32_t)file.size(), (uint32_t)packed.size(), (uint32_t)packed.size()};
+        m_tracks[t] = {index[t].offset, index[t].size, index[t].capacity, hash64(m_buf + offset, len)};
+        file.insert(file.end(), packed.begin(), packed.end());
+    }
+    m_packedFileEnd = file.size();
+
+    PackedHeader header = {{}, c_packedVersion, 0, (uint32_t)m_size, m_trackSize, nTracks};
+    memcpy(header.magic, c_packedMagic, sizeof(header.magic));
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), index.data(), nTracks * sizeof(PackedIndexEntry));
+
+    m_file.seekp(0, ios::beg);
+    m_file.write((const char*)file.data(), file.size());
+    if (m_file.rdstate())
+        throw IFE_WRITE_ERROR;
+}
+
+
+// Packs and writes the track if it was changed. The track is rewritten in place if it fits,
+// otherwise it's appended to the file.
+void ImageFile::writePackedTrack(int track)
+{
+    PackedTrack& packedTrack = m_tracks[track];
+
+    size_t offset = (size_t)track * m_trackSize;
+    size_t len = min((size_t)m_trackSize, m_size - offset);
+
+    uint64_t hash = hash64(m_buf + offset, len);
+    if (hash == packedTrack.hash)
+        return;
+
+    vector<uint8_t> packed;
+    packTrack(m_buf + offset, len, packed);
+    if (packed.size() >= len)
+        packed.assign(m_buf + offset, m_buf + offset + len);
+
+    if (packed.size() > packedTrack.capacity) {
+        packedTrack.offset = m_packedFileEnd;
+        packedTrack.capacity = packed.size();
+        m_packedFileEnd += packed.size();
+    }
+    packedTrack.size = packed.size();
+    packedTrack.hash = hash;
+
+    m_file.seekp(packedTrack.offset, ios::beg);
+    m_file.write((const char*)packed.data(), packed.size());
+
+    PackedIndexEntry entry = {packedTrack.offset, packedTrack.size, packedTrack.capacity};
+    m_file.seekp(sizeof(PackedHeader) + track * sizeof(PackedIndexEntry), ios::beg);
+    m_file.write((const char*)&entry, sizeof(entry));
+
+    if (m_file.rdstate())
+        throw IFE_WRITE_ERROR;
+}
+
+
+void ImageFile::writeRange(size_t offset, size_t size)
+{
+    if (!size)
+        return;
+
+    if (m_packed) {
+        for (size_t t = offset / m_trackSize; t <= (offset + size - 1) / m_trackSize; t++)
+            writePackedTrack(t);
+        return;
+    }
+
+    m_file.seekp(offset, ios::beg);
+    m_file.write((char*)(m_buf + offset), size);
+    if (m_file.rdstate())
+        throw IFE_WRITE_ERROR;
+}
+
+
+void ImageFile::setPacked(bool packed)
+{
+    if (m_mode != IFM_WRITE_CREATE)
+        return;
+
+    m_packed = packed;
+    m_trackSize = c_packedTrackSize;
+}
+
+
+void ImageFile::readOverlay()
+{
+    m_overlay.open(m_overlayFileName, ios::binary | ios::in | ios::out);
+    if (!m_overlay.is_open())
+        return; // no changes yet
+
+    OverlayHeader header;
+    m_overlay.read((char*)&header, sizeof(header));
+    if (m_overlay.fail() || memcmp(header.magic, c_overlayMagic, sizeof(header.magic)) || header.version != c_overlayVersion ||
+            header.blockSize != c_overlayBlockSize)
+        throw IFE_READ_ERROR;
+    if (header.imageSize != m_size || header.baseHash != m_baseHash)
+        throw IFE_OVERLAY_MISMATCH;
+
+    vector<uint8_t> block(c_overlayBlockSize);
+    uint32_t blockNum;
+    uint32_t slot = 0;
+    while (m_overlay.read((char*)&blockNum, sizeof(blockNum)) && m_overlay.read((char*)block.data(), c_overlayBlockSize)) {
+        size_t offset = (size_t)blockNum * c_overlayBlockSize;
+        if (offset >= m_size)
+            throw IFE_READ_ERROR;
+        memcpy(m_buf + offset, block.data(), min((size_t)c_overlayBlockSize, m_size - offset));
+        m_overlayBlocks[blockNum] = slot++;
+    }
+
+    if (m_overlay.bad())
+        throw IFE_READ_ERROR;
+    m_overlay.clear();
+}
+
+
+// Writes blocks covering the given range to the overlay, a block is rewritten in its slot if it's
+// already there. If changedOnly is set, blocks which are not in the overlay and match the base are skipped.
+void ImageFile::writeOverlay(size_t offset, size_t size, bool changedOnly)
+{
+    if (!size)
+        return;
+
+    if (!m_overlay.is_open()) {
+        m_overlay.open(m_overlayFileName, ios::binary | ios::out | ios::trunc);
+        m_overlay.close();
+        m_overlay.open(m_overlayFileName, ios::binary | ios::in | ios::out);
+        if (!m_overlay.is_open())
+            throw IFE_WRITE_ERROR;
+
+        OverlayHeader header = {{}, c_overlayVersion, 0, c_overlayBlockSize, (uint32_t)m_size, m_baseHash};
+        memcpy(header.magic, c_overlayMagic, sizeof(header.magic));
+        m_overlay.write((const char*)&header, sizeof(header));
+    }
+
+    vector<uint8_t> block(c_overlayBlockSize);
+
+    uint32_t firstBlock = offset / c_overlayBlockSize;
+    uint32_t lastBlock = (offset + size - 1) / c_overlayBlockSize;
+
+    for (uint32_t blockNum = firstBlock; blockNum <= lastBlock; blockNum++) {
+        size_t blockOffset = (size_t)blockNum * c_overlayBlockSize;
+        size_t blockLen = min((size_t)c_overlayBlockSize, m_size - blockOffset);
+
+        auto it = m_overlayBlocks.find(blockNum);
+        if (it == m_overlayBlocks.end() && changedOnly && hash64(m_buf + blockOffset, blockLen) == m_baseBlockHashes[blockNum])
+            continue;
+
+        uint32_t slot;
+        if (it != m_overlayBlocks.end())
+            slot = it->second;
+        else {
+            slot = m_overlayBlocks.size();
+            m_overlayBlocks[blockNum] = slot;
+        }
+
+        memset(block.data(), 0, c_overlayBlockSize);
+        memcpy(block.data(), m_buf + blockOffset, blockLen);
+
+        m_overlay.seekp(sizeof(OverlayHeader) + (size_t)slot * (sizeof(blockNum) + c_overlayBlockSize), ios::beg);
+        m_overlay.write((const char*)&blockNum, sizeof(blockNum));
+        m_overlay.write((const char*)block.data(), c_overlayBlockSize);
+    }
+
+    m_overlay.flush();
+    if (m_overlay.rdstate())
+        throw IFE_WRITE_ERROR;
+}
+
+
+void ImageFile::commitOverlay()
+{
+    if (m_mode != IFM_OVERLAY)
+        return;
+
+    m_file.close();
+    m_file.open(m_fileName, ios::binary | ios::in | ios::out);
+    if (!m_file.is_open())
+        throw IFE_OPEN_ERROR;
+
+    for (const auto& block: m_overlayBlocks) {
+        size_t blockOffset = (size_t)block.first * c_overlayBlockSize;
+        writeRange(blockOffset, min((size_t)c_overlayBlockSize, m_size - blockOffset));
+    }
+    m_file.flush();
+    if (m_file.rdstate())
+        throw IFE_WRITE_ERROR;
+
+    if (m_overlay.is_open())
+        m_overlay.close();
+    remove(m_overlayFileName.c_str());
+    m_overlayBlocks.clear();
+
+    m_mode = IFM_READ_WRITE;
+}
+
+
+void ImageFile::discardOverlay()
+{
+    if (m_mode != IFM_OVERLAY)
+        return;
+
+    if (m_overlay.is_open())
+        m_overlay.close();
+    remove(m_overlayFileName.c_str());
+    m_overlayBlocks.clear();
+
+    readImage();
 }
 
 
@@ -100,8 +471,43 @@ void ImageFile::updateAll()
     if (m_mode == IFM_READ_ONLY)
         return;
 
+    if (m_mode == IFM_OVERLAY) {
+        writeOverlay(0, m_size, true);
+        return;
+    }
+
+    if (m_packed) {
+        // only changed tracks are written to an existing image
+        if (m_mode == IFM_WRITE_CREATE)
+            writePacked();
+        else
+            writeRange(0, m_size);
+        return;
+    }
+
     m_file.seekg(0, ios::beg);
     m_file.write((char*)(m_buf), m_size);
     if (m_file.rdstate())
         throw IFE_WRITE_ERROR;
 }
+
+
+// writes only the given part of the image
+void ImageFile::update(size_t offset, size_t size)
+{
+    if (m_mode == IFM_READ_ONLY)
+        return;
+
+    if (m_mode == IFM_WRITE_CREATE) {
+        // new file is written as a whole
+        updateAll();
+        return;
+    }
+
+    if (m_mode == IFM_OVERLAY) {
+        writeOverlay(offset, size);
+        return;
+    }
+
+    writeRange(offset, size);
+}
@@ -20,36 +20,89 @@
 
 #include <string>
 #include <fstream>
+#include <map>
+#include <vector>
 
 enum ImageFileMode {
     IFM_READ_ONLY,
     IFM_READ_WRITE,
-    IFM_WRITE_CREATE
+    IFM_WRITE_CREATE,
+    IFM_OVERLAY         // copy-on-write, see the overlay constructor
 };
 
 enum ImageFileException {
     IFE_OPEN_ERROR,
     IFE_READ_ERROR,
-    IFE_WRITE_ERROR
+    IFE_WRITE_ERROR,
+    IFE_OVERLAY_MISMATCH    // overlay was made for another base image
 };
 
 class ImageFile
 {
 public:
     ImageFile(const std::string& fileName, ImageFileMode mode, int imageSize = 0);
+
+    // Copy-on-write mode: the base image is opened read only, changed blocks are written to the overlay
+    // file, which is created on the first write. Existing overlay is applied to the image data, an overlay
+    // made for different base image data throws IFE_OVERLAY_MISMATCH.
+    ImageFile(const std::string& baseFileName, const std::string& overlayFileName);
+
     ~ImageFile();
 
     bool isOpen();
     size_t getSize();
     uint8_t* getData();
     void updateAll();
+    void update(size_t offset, size_t size);
     uint8_t& operator[](std::ptrdiff_t idx);
 
+    // merges the overlay into the base image and deletes it, image is opened read-write then
+    void commitOverlay();
+    // drops all changes, base image data is reloaded and the overlay is deleted
+    void discardOverlay();
+    int getOverlayBlocks() {return m_overlayBlocks.size();}
+
+    // Packed image: tracks are packed independently (see trackcodec.h) and listed in an index.
+    // Packed images are recognized on open and unpacked, only changed tracks are packed and written back.
+    // setPacked() makes a new image (IFM_WRITE_CREATE) be written packed.
+    bool isPacked() {return m_packed;}
+    void setPacked(bool packed);
+
 private:
     std::fstream m_file;
     size_t m_size = 0;
     uint8_t* m_buf = nullptr;
     ImageFileMode m_mode;
+
+    std::string m_fileName;
+    std::string m_overlayFileName;
+    std::fstream m_overlay;
+    std::map<uint32_t, uint32_t> m_overlayBlocks;   // block number -> slot in the overlay file
+
+    std::vector<uint64_t> m_baseBlockHashes;        // hashes of unchanged base blocks
+    uint64_t m_baseHash = 0;                        // whole base image, stored in the overlay header
+
+    struct PackedTrack {
+        uint32_t offset;
+        uint32_t size;      // equals track size if the track is stored as is
+        uint32_t capacity;  // space reserved in the file
+        uint64_t hash;      // hash of the track data as written
+    };
+
+    bool m_packed = false;
+    uint32_t m_trackSize = 0;
+    std::vector<PackedTrack> m_tracks;
+    uint32_t m_packedFileEnd = 0;
+
+    void allocBuffer(size_t size);
+    void readImage();
+    void readPacked(const std::vector<uint8_t>& file);
+    void writePacked();
+    void writePackedTrack(int track);
+    void writeRange(size_t offset, size_t size);
+
+    void readOverlay();
+    void writeOverlay(size_t offset, size_t size, bool changedOnly = false);
 };
 
 #endif // IMAGEFILE_H
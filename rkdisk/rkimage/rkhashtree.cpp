@@ -0,0 +1,150 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include "rkhashtree.h"
+
+using namespace std;
+
+
+#pragma pack(push, 1)
+
+// followed by sector hashes, track hashes and file records
+struct HashTreeHeader {
+    char magic[4];      // "RKHT"
+    uint16_t version;
+    uint8_t fileSystem;
+    uint8_t reserved;
+    uint64_t imageSize;
+    int64_t imageMtime; // nanoseconds
+    int64_t imageCtime;
+    uint64_t root;
+    uint32_t nFiles;
+};
+
+struct HashTreeFile {
+    char fileName[16];  // zero padded
+    uint64_t hash;
+};
+
+#pragma pack(pop)
+
+static const char c_hashTreeMagic[4] = {'R', 'K', 'H', 'T'};
+static const uint16_t c_hashTreeVersion = 2;
+
+
+void RkHashTree::compare(const RkHashTree& other, vector<pair<int, int>>& changedSectors) const
+{
+    changedSectors.clear();
+
+    if (root == other.root)
+        return;
+
+    for (int t = 0; t < 160; t++) {
+        if (tracks[t] == other.tracks[t])
+            continue;
+        for (int s = 0; s < 5; s++)
+            if (sectors[t][s] != other.sectors[t][s])
+                changedSectors.push_back({t, s});
+    }
+}
+
+
+void RkHashTree::compareFiles(const RkHashTree& other, vector<string>& addedFiles, vector<string>& removedFiles,
+                              vector<string>& changedFiles) const
+{
+    addedFiles.clear();
+    removedFiles.clear();
+    changedFiles.clear();
+
+    if (root == other.root)
+        return;
+
+    // both maps are sorted by name
+    auto it = files.begin();
+    auto otherIt = other.files.begin();
+    while (it != files.end() || otherIt != other.files.end()) {
+        if (otherIt == other.files.end() || (it != files.end() && it->first < otherIt->first))
+            removedFiles.push_back((it++)->first);
+        else if (it == files.end() || otherIt->first < it->first)
+            addedFiles.push_back((otherIt++)->first);
+        else {
+            if (it->second != otherIt->second)
+                changedFiles.push_back(it->first);
+            ++it;
+            ++otherIt;
+        }
+    }
+}
+
+
+bool RkHashTree::load(const string& fileName, const FileStamp& imageStamp)
+{
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail())
+        return false;
+
+    HashTreeHeader header;
+    f.read((char*)&header, sizeof(header));
+    if (f.fail() || memcmp(header.magic, c_hashTreeMagic, sizeof(header.magic)) || header.version != c_hashTreeVersion ||
+            !(FileStamp{header.imageSize, header.imageMtime, header.imageCtime} == imageStamp))
+        return false;
+
+    f.read((char*)sectors, sizeof(sectors));
+    f.read((char*)tracks, sizeof(tracks));
+
+    files.clear();
+    for (uint32_t i = 0; i < header.nFiles && f; i++) {
+        HashTreeFile file;
+        f.read((char*)&file, sizeof(file));
+        files[string(file.fileName, strnlen(file.fileName, sizeof(file.fileName)))] = file.hash;
+    }
+
+    if (f.fail())
+        return false;
+
+    root = header.root;
+    fileSystem = header.fileSystem != 0;
+
+    return true;
+}
+
+
+bool RkHashTree::save(const string& fileName, const FileStamp& imageStamp) const
+{
+    ofstream f(fileName, ofstream::binary | ofstream::trunc);
+
+    HashTreeHeader header = {{}, c_hashTreeVersion, fileSystem, 0, imageStamp.size, imageStamp.mtime, imageStamp.ctime, root,
+                             (uint32_t)files.size()};
+    memcpy(header.magic, c_hashTreeMagic, sizeof(header.magic));
+    f.write((const char*)&header, sizeof(header));
+
+    f.write((const char*)sectors, sizeof(sectors));
+    f.write((const char*)tracks, sizeof(tracks));
+
+    for (const auto& it: files) {
+        HashTreeFile file = {{}, it.second};
+        memcpy(file.fileName, it.first.data(), min(it.first.size(), sizeof(file.fileName)));
+        f.write((const char*)&file, sizeof(file));
+    }
+
+    f.close();
+    return !f.fail();
+}
@@ -0,0 +1,52 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RKHASHTREE_H
+#define RKHASHTREE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../../common/filestamp.h"
+
+
+// Hash tree of an RK DOS image built by RkVolume::getHashTree(). Sector hashes cover the sector
+// payload, track hashes cover the hashes of 5 sectors and the root covers 160 track hashes,
+// so equal roots mean equal images and changed sectors are found by descending through changed
+// tracks only. File hashes are derived from the sector hashes in TS list order and the directory
+// entry fields, files aren't read to compute them.
+struct RkHashTree {
+    uint64_t root = 0;
+    uint64_t tracks[160] = {};
+    uint64_t sectors[160][5] = {};
+    bool fileSystem = false;                // file hashes are valid
+    std::map<std::string, uint64_t> files;  // file name -> file hash
+
+    // changed sectors as track and sector numbers
+    void compare(const RkHashTree& other, std::vector<std::pair<int, int>>& changedSectors) const;
+    void compareFiles(const RkHashTree& other, std::vector<std::string>& addedFiles, std::vector<std::string>& removedFiles,
+                      std::vector<std::string>& changedFiles) const;
+
+    // The tree is stored with the image size, modification and status change times, load() fails
+    // if they don't match, so a stale tree is never used
+    bool load(const std::string& fileName, const FileStamp& imageStamp);
+    bool save(const std::string& fileName, const FileStamp& imageStamp) const;
+};
+
+#endif // RKHASHTREE_H
@@ -23,11 +23,13 @@
 #include <algorithm>
 
 #include "rkvolume.h"
+#include "../../common/hash.h"
 
 using namespace std;
 
 
-RkVolume::RkVolume(const std::string& fileName, ImageFileMode mode) : Volume(fileName, mode, mode == IFM_WRITE_CREATE ? 500000 : 0)
+RkVolume::RkVolume(const std::string& fileName, ImageFileMode mode, const std::string& overlayFileName) :
+    Volume(fileName, mode, mode == IFM_WRITE_CREATE ? 500000 : 0, overlayFileName)
 {
 }
 
@@ -62,7 +64,8 @@ void RkVolume::readDisk()
     if (m_diskRead)
         return;
 
-    readSectors();
+    if (!m_sectorsRead)
+        readSectors();
     readVtoc();
     readDir();
 
@@ -127,6 +130,8 @@ void RkVolume::readSectors()
         if (!allSect)
             throw RkVolumeException {RkVolumeException::RVET_BAD_DISK_FORMAT}; // there are missings sectors on the track
     }
+
+    m_sectorsRead = true;
 }
 
 
@@ -293,52 +298,116 @@ uint8_t* RkVolume::readFile(std::string fileName, int& len)
 
     auto fi = find_if(m_fileList.begin(), m_fileList.end(), [fileName](const auto& x) {return fileName == x.fileName;});
     if (fi != m_fileList.end()) {
+        vector<RkFileSector> sectors = getFileSectors(*fi);
+
         len = fi->fileSize;
 
         int left = fi->fileSize;
         int bufPos = 0;
         uint8_t* buf = new uint8_t[left];
 
-        int t = fi->tList;
-        int s = fi->sList;
+        for (const RkFileSector& sector: sectors) {
+            int toRead = sector.size;
+            if (toRead <= left) {
+                memcpy(buf + bufPos, sector.data, toRead);
+                bufPos += toRead;
+                left -= toRead;
+            }
+        }
+        return buf;
+    } else
+        throw RkVolumeException {RkVolumeException::RVET_FILE_NOT_FOUND};
 
-        if (t >= 160 || s >= 5)
-            throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, t, s};
+    return nullptr;
+}
 
-        do {
-            uint8_t* ptr = m_sectors[t][s].ptr;
-            int sectorSize = m_sectors[t][s].len;
 
-            t = ptr[0];
-            s = ptr[1];
+// Sector map only, the image is not required to have a file system
+const RkSector& RkVolume::getSector(int track, int sector)
+{
+    if (!m_sectorsRead)
+        readSectors();
 
-            if (t >= 160 || s >= 5)
-                throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, t, s};
+    return m_sectors[track][sector];
+}
 
-            int tslistPos = 2;
-            while (tslistPos <= sectorSize - 2) {
-                int nextTrack = ptr[tslistPos++];
-                int nextSector = ptr[tslistPos++];
 
-                if (nextTrack >= 160 || nextSector >= 5)
-                    throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, nextTrack, nextSector};
+// Sector map is required, file hashes are computed only if the image has a file system
+void RkVolume::getHashTree(RkHashTree& tree)
+{
+    if (!m_sectorsRead)
+        readSectors();
 
-                if (nextTrack || nextSector) {
-                    int toRead = m_sectors[nextTrack][nextSector].len;
-                    if (toRead <= left) {
-                        memcpy(buf + bufPos, m_sectors[nextTrack][nextSector].ptr, toRead);
-                        bufPos += toRead;
-                        left -= toRead;
-                    }
-                } else
-                    break;
-            }
-        } while (t || s);
-        return buf;
-    } else
-        throw RkVolumeException {RkVolumeException::RVET_FILE_NOT_FOUND};
+    for (int t = 0; t < 160; t++) {
+        for (int s = 0; s < 5; s++) {
+            const RkSector& sector = m_sectors[t][s];
+            tree.sectors[t][s] = hash64(sector.ptr, min((int)sector.len, 512), hash64(&sector.len, sizeof(sector.len)));
+        }
+        tree.tracks[t] = hash64(tree.sectors[t], sizeof(tree.sectors[t]));
+    }
+    tree.root = hash64(tree.tracks, sizeof(tree.tracks));
+
+    tree.files.clear();
+    tree.fileSystem = false;
+
+    try {
+        for (const RkFileInfo& fi: *getFileList()) {
+            uint8_t entry[] = {fi.attr, (uint8_t)fi.addr, (uint8_t)(fi.addr >> 8),
+                               (uint8_t)fi.fileSize, (uint8_t)(fi.fileSize >> 8), (uint8_t)(fi.fileSize >> 16)};
+            uint64_t hash = hash64(entry, sizeof(entry));
+            for (const RkFileSector& sector: getFileSectors(fi))
+                hash = hash64(&tree.sectors[sector.track][sector.sector], sizeof(uint64_t), hash);
+            tree.files[fi.fileName] = hash;
+        }
+        tree.fileSystem = true;
+    }
 
-    return nullptr;
+    catch (RkVolumeException&) {
+        tree.files.clear();
+    }
+}
+
+
+// Follows the TS lists of a file, data sectors are returned in file order without copying
+vector<RkFileSector> RkVolume::getFileSectors(const RkFileInfo& fileInfo)
+{
+    readDisk();
+
+    vector<RkFileSector> sectors;
+
+    int t = fileInfo.tList;
+    int s = fileInfo.sList;
+
+    if (t >= 160 || s >= 5)
+        throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, t, s};
+
+    do {
+        uint8_t* ptr = m_sectors[t][s].ptr;
+        int sectorSize = m_sectors[t][s].len;
+
+        t = ptr[0];
+        s = ptr[1];
+
+        if (t >= 160 || s >= 5)
+            throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, t, s};
+
+        int tslistPos = 2;
+        while (tslistPos <= sectorSize - 2) {
+            int nextTrack = ptr[tslistPos++];
+            int nextSector = ptr[tslistPos++];
+
+            if (nextTrack >= 160 || nextSector >= 5)
+                throw RkVolumeException {RkVolumeException::RVET_SECTOR_NOT_FOUND, nextTrack, nextSector};
+
+            if (nextTrack || nextSector)
+                sectors.push_back({m_sectors[nextTrack][nextSector].ptr, m_sectors[nextTrack][nextSector].len,
+                                   (uint8_t)nextTrack, (uint8_t)nextSector});
+            else
+                break;
+        }
+    } while (t || s);
+
+    return sectors;
 }
 
 
@@ -550,6 +619,7 @@ void RkVolume::deleteFile(std::string fileName)
 
     dir[10] = dir[0];
     dir[0] = 0xFF;
+    m_sectors[fi->dirTrack][fi->dirSector].dirty = true;
 
     int t = fi->tList;
     int s = fi->sList;
@@ -681,6 +751,8 @@ void RkVolume::format(int directorySize)
         }
     }
 
+    m_formatted = true;
+
     updateSectors();
 }
 
@@ -703,7 +775,23 @@ void RkVolume::updateSectors()
 }
 
 
+// Writes only changed sectors (length, data and checksum) unless the image was formatted
 void RkVolume::saveImage()
 {
-    m_image->updateAll();
+    if (m_formatted || !m_diskRead) {
+        m_image->updateAll();
+        m_formatted = false;
+    } else {
+        uint8_t* imageData = m_image->getData();
+        for (int t = 0; t < 160; t++)
+            for (int s = 0; s < 5; s++)
+                if (m_sectors[t][s].dirty) {
+                    uint8_t* ptr = m_sectors[t][s].ptr - 3;
+                    m_image->update(ptr - imageData, 3 + 512 + 2);
+                }
+    }
+
+    for (int t = 0; t < 160; t++)
+        for (int s = 0; s < 5; s++)
+            m_sectors[t][s].dirty = false;
 }
@@ -19,8 +19,10 @@
 #define RKVOLUME_H
 
 #include <list>
+#include <vector>
 
 #include "volume.h"
+#include "rkhashtree.h"
 
 struct RkSector {
     uint8_t* ptr;
@@ -29,6 +31,13 @@ struct RkSector {
     bool allocated;
 };
 
+struct RkFileSector {
+    const uint8_t* data;
+    int size;
+    uint8_t track;
+    uint8_t sector;
+};
+
 struct RkFileInfo {
     std::string fileName;
     uint8_t dirTrack;
@@ -63,7 +72,7 @@ public:
         int sector = 0;
     };
 
-    RkVolume(const std::string& fileName, ImageFileMode mode);
+    RkVolume(const std::string& fileName, ImageFileMode mode, const std::string& overlayFileName = "");
 
     bool isValid() override;
 
@@ -73,6 +82,9 @@ public:
     int getFreeDirEntries();
 
     uint8_t* readFile(std::string fileName, int& size);
+    std::vector<RkFileSector> getFileSectors(const RkFileInfo& fileInfo);
+    const RkSector& getSector(int track, int sector);
+    void getHashTree(RkHashTree& tree);
     void writeFile(std::string fileName, uint8_t* data, int size, uint16_t addr = 0, uint8_t attr = 0, bool allowOverwrite = false);
     void deleteFile(std::string fileName);
     void setAttributes(std::string fileName, uint8_t attr);
@@ -88,6 +100,8 @@ private:
     int m_freeDirEntries = 0;
 
     bool m_diskRead = false;
+    bool m_sectorsRead = false;
+    bool m_formatted = false;  // whole image is to be written
 
     void readDisk();
 
@@ -0,0 +1,150 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "trackcodec.h"
+
+using namespace std;
+
+
+static const int c_hashBits = 12;
+static const int c_maxChain = 16;
+
+static const size_t c_minMatch = 3;
+static const size_t c_maxMatch = 0x7FF + c_minMatch;
+static const size_t c_maxDistance = 0x1000;
+static const size_t c_maxLiterals = 0x80;
+
+
+static inline unsigned hash3(const uint8_t* p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - c_hashBits);
+}
+
+
+static void flushLiterals(const uint8_t* data, size_t start, size_t end, vector<uint8_t>& packed)
+{
+    while (start < end) {
+        size_t n = min(end - start, c_maxLiterals);
+        packed.push_back(uint8_t(n - 1));
+        packed.insert(packed.end(), data + start, data + start + n);
+        start += n;
+    }
+}
+
+
+void packTrack(const uint8_t* data, size_t size, vector<uint8_t>& packed)
+{
+    packed.clear();
+
+    // hash chains of 3-byte sequences
+    vector<int> head(1 << c_hashBits, -1);
+    vector<int> prev(size, -1);
+
+    auto insert = [&](size_t pos) {
+        if (pos + c_minMatch <= size) {
+            unsigned h = hash3(data + pos);
+            prev[pos] = head[h];
+            head[h] = int(pos);
+        }
+    };
+
+    size_t litStart = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t maxLen = min(c_maxMatch, size - pos);
+        size_t bestLen = 0;
+        size_t bestDist = 0;
+
+        // runs are the most common case, they are checked first
+        if (pos > 0) {
+            while (bestLen < maxLen && data[pos + bestLen] == data[pos - 1])
+                ++bestLen;
+            bestDist = 1;
+        }
+
+        if (pos + c_minMatch <= size && bestLen < maxLen) {
+            int chain = c_maxChain;
+            for (int cand = head[hash3(data + pos)]; cand >= 0 && chain--; cand = prev[cand]) {
+                size_t dist = pos - cand;
+                if (dist > c_maxDistance)
+                    break;
+                size_t len = 0;
+                while (len < maxLen && data[cand + len] == data[pos + len])
+                    ++len;
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestDist = dist;
+                    if (len == maxLen)
+                        break;
+                }
+            }
+        }
+
+        if (bestLen < c_minMatch) {
+            insert(pos++);
+            continue;
+        }
+
+        flushLiterals(data, litStart, pos, packed);
+        size_t len = bestLen - c_minMatch;
+        size_t dist = bestDist - 1;
+        packed.push_back(uint8_t(0x80 | (len >> 4)));
+        packed.push_back(uint8_t(((len & 0x0F) << 4) | (dist >> 8)));
+        packed.push_back(uint8_t(dist & 0xFF));
+
+        for (size_t i = 0; i < bestLen; i++)
+            insert(pos++);
+        litStart = pos;
+    }
+
+    flushLiterals(data, litStart, size, packed);
+}
+
+
+bool unpackTrack(const uint8_t* packed, size_t packedSize, uint8_t* data, size_t size)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < packedSize) {
+        uint8_t token = packed[in++];
+        if (token < 0x80) {
+            size_t n = token + 1;
+            if (in + n > packedSize || out + n > size)
+                return false;
+            copy(packed + in, packed + in + n, data + out);
+            in += n;
+            out += n;
+        } else {
+            if (in + 2 > packedSize)
+                return false;
+            size_t len = (((token & 0x7F) << 4) | (packed[in] >> 4)) + c_minMatch;
+            size_t dist = (((packed[in] & 0x0F) << 8) | packed[in + 1]) + 1;
+            in += 2;
+            if (dist > out || out + len > size)
+                return false;
+            // byte by byte, the source may overlap the destination
+            for (size_t i = 0; i < len; i++, out++)
+                data[out] = data[out - dist];
+        }
+    }
+
+    return out == size;
+}
@@ -0,0 +1,38 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKCODEC_H
+#define TRACKCODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// LZ codec for disk tracks. Tracks are packed independently, so any track can be unpacked alone.
+// Runs of sync bytes, gaps and padding are coded as matches at distance 1.
+//
+// Packed stream format:
+//   00..7F             - (token + 1) literal bytes follow
+//   80..FF, b1, b2     - match: length = ((token & 7F) << 4 | b1 >> 4) + 3,
+//                        distance = ((b1 & 0F) << 8 | b2) + 1
+void packTrack(const uint8_t* data, size_t size, std::vector<uint8_t>& packed);
+
+// returns false if packed data is bad or doesn't unpack to exactly size bytes
+bool unpackTrack(const uint8_t* packed, size_t packedSize, uint8_t* data, size_t size);
+
+#endif // TRACKCODEC_H
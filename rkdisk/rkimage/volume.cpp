@@ -21,12 +21,25 @@
 
 using namespace std;
 
-Volume::Volume(const string& fileName, ImageFileMode mode, int imageSize)
+Volume::Volume(const string& fileName, ImageFileMode mode, int imageSize, const string& overlayFileName)
 {
-    m_image = new ImageFile(fileName, mode, imageSize);
+    if (!overlayFileName.empty() && mode != IFM_WRITE_CREATE)
+        m_image = new ImageFile(fileName, overlayFileName);
+    else
+        m_image = new ImageFile(fileName, mode, imageSize);
 }
 
 Volume::~Volume()
 {
     delete m_image;
 }
+
+const uint8_t* Volume::getImageData()
+{
+    return m_image->getData();
+}
+
+size_t Volume::getImageSize()
+{
+    return m_image->getSize();
+}
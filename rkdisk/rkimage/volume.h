@@ -26,11 +26,15 @@
 class Volume
 {
 public:
-    Volume(const std::string& fileName, ImageFileMode mode, int imageSize = 0);
+    // if overlayFileName is given, an existing image is opened in copy-on-write mode, see ImageFile
+    Volume(const std::string& fileName, ImageFileMode mode, int imageSize = 0, const std::string& overlayFileName = "");
     ~Volume();
 
     virtual bool isValid() = 0;
 
+    const uint8_t* getImageData();
+    size_t getImageSize();
+
 protected:
     uint8_t* m_fileBuf = nullptr;
     ImageFile* m_image = nullptr;
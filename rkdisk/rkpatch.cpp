@@ -0,0 +1,221 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <map>
+#include <algorithm>
+
+#include "rkpatch.h"
+#include "rkimage/rkvolume.h"
+#include "../common/hash.h"
+
+using namespace std;
+
+
+#pragma pack(push, 1)
+
+struct PatchHeader {
+    char magic[4];      // "RKDP"
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t imageSize;
+    uint64_t oldHash;
+    uint64_t newHash;
+    uint32_t nRecords;
+};
+
+// followed by size bytes of new data
+struct PatchRecord {
+    uint32_t offset;
+    uint16_t size;
+};
+
+#pragma pack(pop)
+
+static const char c_patchMagic[4] = {'R', 'K', 'D', 'P'};
+static const uint16_t c_patchVersion = 1;
+
+static const int c_trackSize = 3125;
+
+// sector length, data and checksum as written by RkVolume::saveImage()
+static const int c_sectorRecordPrefix = 3;
+static const int c_sectorRecordSize = 3 + 512 + 2;
+
+
+// Adds a record for the differing part of the range, returns false if the range is the same
+static bool addRecord(const uint8_t* oldData, const uint8_t* newData, size_t offset, size_t size, vector<uint8_t>& patch, uint32_t& nRecords)
+{
+    // most ranges are equal, a single memcmp rejects them
+    if (!memcmp(oldData + offset, newData + offset, size))
+        return false;
+
+    size_t first = offset;
+    while (oldData[first] == newData[first])
+        ++first;
+
+    size_t last = offset + size - 1;
+    while (oldData[last] == newData[last])
+        --last;
+
+    PatchRecord record = {(uint32_t)first, (uint16_t)(last - first + 1)};
+    patch.insert(patch.end(), (const uint8_t*)&record, (const uint8_t*)&record + sizeof(record));
+    patch.insert(patch.end(), newData + first, newData + last + 1);
+    ++nRecords;
+
+    return true;
+}
+
+
+static void diffFiles(RkVolume& oldVol, RkVolume& newVol, RkImageDiff& diff)
+{
+    map<string, const RkFileInfo*> oldFiles;
+    for (const RkFileInfo& fi: *oldVol.getFileList())
+        oldFiles[fi.fileName] = &fi;
+
+    for (const RkFileInfo& fi: *newVol.getFileList()) {
+        auto it = oldFiles.find(fi.fileName);
+        if (it == oldFiles.end()) {
+            diff.addedFiles.push_back(fi.fileName);
+            continue;
+        }
+
+        const RkFileInfo* oldFi = it->second;
+        oldFiles.erase(it);
+
+        bool changed = oldFi->fileSize != fi.fileSize || oldFi->addr != fi.addr || oldFi->attr != fi.attr;
+        if (!changed) {
+            int oldSize, newSize;
+            uint8_t* oldData = oldVol.readFile(fi.fileName, oldSize);
+            uint8_t* newData = newVol.readFile(fi.fileName, newSize);
+            changed = memcmp(oldData, newData, newSize) != 0;
+            delete[] oldData;
+            delete[] newData;
+        }
+
+        if (changed)
+            diff.changedFiles.push_back(fi.fileName);
+    }
+
+    for (const auto& file: oldFiles)
+        diff.removedFiles.push_back(file.first);
+}
+
+
+void diffImages(const string& oldFileName, const string& newFileName, RkImageDiff& diff, vector<uint8_t>& patch)
+{
+    RkVolume oldVol(oldFileName, IFM_READ_ONLY);
+    RkVolume newVol(newFileName, IFM_READ_ONLY);
+
+    size_t imageSize = oldVol.getImageSize();
+    if (newVol.getImageSize() != imageSize)
+        throw RkVolume::RkVolumeException {RkVolume::RkVolumeException::RVET_BAD_DISK_FORMAT};
+
+    const uint8_t* oldData = oldVol.getImageData();
+    const uint8_t* newData = newVol.getImageData();
+
+    // old image with changed sectors replaced, what's left differs in track structure
+    vector<uint8_t> work(oldData, oldData + imageSize);
+
+    PatchHeader header = {{}, c_patchVersion, 0, (uint32_t)imageSize, hash64(oldData, imageSize), hash64(newData, imageSize), 0};
+    memcpy(header.magic, c_patchMagic, sizeof(header.magic));
+    patch.assign((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+
+    try {
+        if (oldVol.isValid() && newVol.isValid()) {
+            for (int t = 0; t < 160; t++)
+                for (int s = 0; s < 5; s++) {
+                    size_t oldOffset = oldVol.getSector(t, s).ptr - oldData - c_sectorRecordPrefix;
+                    size_t newOffset = newVol.getSector(t, s).ptr - newData - c_sectorRecordPrefix;
+                    if (oldOffset != newOffset || oldOffset + c_sectorRecordSize > imageSize)
+                        continue;
+                    if (addRecord(oldData, newData, oldOffset, c_sectorRecordSize, patch, header.nRecords)) {
+                        memcpy(work.data() + oldOffset, newData + oldOffset, c_sectorRecordSize);
+                        ++diff.nChangedSectors;
+                    }
+                }
+        }
+    }
+
+    catch (RkVolume::RkVolumeException&) {
+        // no sector map, whole tracks are compared
+    }
+
+    for (size_t offset = 0; offset < imageSize; offset += c_trackSize)
+        if (addRecord(work.data(), newData, offset, min((size_t)c_trackSize, imageSize - offset), patch, header.nRecords))
+            ++diff.nChangedTracks;
+
+    memcpy(patch.data(), &header, sizeof(header));
+
+    try {
+        if (oldVol.isValid() && newVol.isValid()) {
+            diffFiles(oldVol, newVol, diff);
+            diff.fileSystems = true;
+        }
+    }
+
+    catch (RkVolume::RkVolumeException&) {
+        diff.addedFiles.clear();
+        diff.removedFiles.clear();
+        diff.changedFiles.clear();
+    }
+}
+
+
+PatchResult applyPatch(uint8_t* image, size_t imageSize, const vector<uint8_t>& patch, vector<pair<size_t, size_t>>& changedRanges)
+{
+    changedRanges.clear();
+
+    PatchHeader header;
+    if (patch.size() < sizeof(header))
+        return PR_BAD_PATCH;
+    memcpy(&header, patch.data(), sizeof(header));
+
+    if (memcmp(header.magic, c_patchMagic, sizeof(header.magic)) || header.version != c_patchVersion)
+        return PR_BAD_PATCH;
+
+    if (header.imageSize != imageSize || header.oldHash != hash64(image, imageSize))
+        return PR_WRONG_IMAGE;
+
+    vector<uint8_t> work(image, image + imageSize);
+
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; i < header.nRecords; i++) {
+        PatchRecord record;
+        if (pos + sizeof(record) > patch.size())
+            return PR_BAD_PATCH;
+        memcpy(&record, patch.data() + pos, sizeof(record));
+        pos += sizeof(record);
+
+        // patches come from outside, sums of record fields may overflow
+        if (record.size > patch.size() - pos || record.offset > imageSize || record.size > imageSize - record.offset)
+            return PR_BAD_PATCH;
+
+        memcpy(work.data() + record.offset, patch.data() + pos, record.size);
+        changedRanges.push_back({record.offset, record.size});
+        pos += record.size;
+    }
+
+    if (pos != patch.size())
+        return PR_BAD_PATCH;
+
+    if (hash64(work.data(), imageSize) != header.newHash)
+        return PR_CHECKSUM_ERROR;
+
+    memcpy(image, work.data(), imageSize);
+
+    return PR_OK;
+}
@@ -0,0 +1,56 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RKPATCH_H
+#define RKPATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+struct RkImageDiff {
+    std::vector<std::string> addedFiles;
+    std::vector<std::string> removedFiles;
+    std::vector<std::string> changedFiles;
+    bool fileSystems = false;   // both images have RK DOS file system, file lists are valid
+    int nChangedSectors = 0;
+    int nChangedTracks = 0;     // changes outside of sectors (track structure)
+};
+
+
+enum PatchResult {
+    PR_OK,
+    PR_BAD_PATCH,
+    PR_WRONG_IMAGE,     // the patch was made for another image
+    PR_CHECKSUM_ERROR
+};
+
+
+// Compares two images of the same size. Changed sectors (length, data and checksum) are compared
+// in place using the sector maps of both images, differences outside of sectors are taken track by track.
+// The patch contains changed byte ranges only and turns the old image into the new one.
+// Throws ImageFileException and RkVolumeException (RVET_BAD_DISK_FORMAT if image sizes differ).
+void diffImages(const std::string& oldFileName, const std::string& newFileName, RkImageDiff& diff, std::vector<uint8_t>& patch);
+
+// Applies a patch to image data, the result is verified before the image is modified.
+// changedRanges receives offsets and sizes of the modified ranges.
+PatchResult applyPatch(uint8_t* image, size_t imageSize, const std::vector<uint8_t>& patch,
+                       std::vector<std::pair<size_t, size_t>>& changedRanges);
+
+#endif // RKPATCH_H
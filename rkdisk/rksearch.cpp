@@ -0,0 +1,112 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "rksearch.h"
+
+using namespace std;
+
+
+SectorSearch::SectorSearch(const vector<string>& patterns) : m_patterns(patterns)
+{
+    for (const string& pattern: m_patterns)
+        m_maxLen = max(m_maxLen, (int)pattern.size());
+}
+
+
+void SectorSearch::reset()
+{
+    m_tail.clear();
+    m_offset = 0;
+}
+
+
+// Finds matches starting before maxStart and ending after minEnd.
+// Candidates are located with memchr on the first pattern byte.
+void SectorSearch::searchBlock(const uint8_t* data, int size, int maxStart, int minEnd, int baseOffset, vector<SearchMatch>& matches)
+{
+    for (unsigned i = 0; i < m_patterns.size(); i++) {
+        const uint8_t* pattern = (const uint8_t*)m_patterns[i].data();
+        int len = m_patterns[i].size();
+        if (!len || len > size)
+            continue;
+
+        int start = max(0, minEnd - len + 1);
+        int lastStart = min(size - len, maxStart - 1);
+
+        while (start <= lastStart) {
+            const uint8_t* found = (const uint8_t*)memchr(data + start, pattern[0], lastStart - start + 1);
+            if (!found)
+                break;
+            start = found - data;
+            if (!memcmp(found + 1, pattern + 1, len - 1))
+                matches.push_back({(int)i, baseOffset + start});
+            ++start;
+        }
+    }
+}
+
+
+void SectorSearch::feed(const uint8_t* data, int size, vector<SearchMatch>& matches)
+{
+    // matches starting in previous sectors and ending in this one
+    if (!m_tail.empty()) {
+        int tailSize = m_tail.size();
+        string seam = m_tail;
+        seam.append((const char*)data, min(size, m_maxLen - 1));
+        searchBlock((const uint8_t*)seam.data(), seam.size(), tailSize, tailSize, m_offset - tailSize, matches);
+    }
+
+    searchBlock(data, size, size, 0, m_offset, matches);
+
+    m_offset += size;
+
+    if (m_maxLen > 1) {
+        int keep = min(size, m_maxLen - 1);
+        m_tail.append((const char*)data + size - keep, keep);
+        if ((int)m_tail.size() > m_maxLen - 1)
+            m_tail.erase(0, m_tail.size() - (m_maxLen - 1));
+    }
+}
+
+
+bool parseHexPattern(const string& hex, string& pattern)
+{
+    pattern.clear();
+
+    string digits;
+    for (char ch: hex)
+        if (ch != ' ')
+            digits.push_back(ch);
+
+    if (digits.empty() || digits.size() % 2)
+        return false;
+
+    for (unsigned i = 0; i < digits.size(); i += 2) {
+        char* numEnd;
+        string byteStr = digits.substr(i, 2);
+        unsigned long value = strtoul(byteStr.c_str(), &numEnd, 16);
+        if (*numEnd || byteStr[0] == '+' || byteStr[0] == '-')
+            return false;
+        pattern.push_back((char)value);
+    }
+
+    return true;
+}
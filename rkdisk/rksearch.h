@@ -0,0 +1,60 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RKSEARCH_H
+#define RKSEARCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct SearchMatch {
+    int pattern;    // index in the pattern list
+    int offset;     // offset in the file
+};
+
+
+// Multi-pattern substring search in a file passed as a sequence of sector buffers.
+// Matches crossing sector boundaries are found using the tail of the previous sectors,
+// so files are never assembled in memory.
+class SectorSearch
+{
+public:
+    explicit SectorSearch(const std::vector<std::string>& patterns);
+
+    // starts a new file
+    void reset();
+
+    // searches the next sector of the file, matches are appended in no particular order
+    void feed(const uint8_t* data, int size, std::vector<SearchMatch>& matches);
+
+private:
+    std::vector<std::string> m_patterns;
+    int m_maxLen = 0;
+
+    std::string m_tail;     // last m_maxLen - 1 bytes of the file fed so far
+    int m_offset = 0;       // file offset of the next sector
+
+    void searchBlock(const uint8_t* data, int size, int maxStart, int minEnd, int baseOffset, std::vector<SearchMatch>& matches);
+};
+
+
+// Parses a pattern given as hex bytes ("CD0300", "CD 03 00"), returns false on error
+bool parseHexPattern(const std::string& hex, std::string& pattern);
+
+#endif // RKSEARCH_H
@@ -0,0 +1,347 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "rkstore.h"
+#include "rkimage/rkvolume.h"
+#include "../common/hash.h"
+
+using namespace std;
+
+
+// residual image data is stored in track sized chunks
+static const int c_chunkSize = 3125;
+
+
+static bool makeDir(const string& dirName)
+{
+#ifdef _WIN32
+    _mkdir(dirName.c_str());
+#else
+    mkdir(dirName.c_str(), 0777);
+#endif
+    struct stat st;
+    return !stat(dirName.c_str(), &st) && S_ISDIR(st.st_mode);
+}
+
+
+static string hashToString(uint64_t hash)
+{
+    ostringstream ss;
+    ss << hex << setfill('0') << setw(16) << hash;
+    return ss.str();
+}
+
+
+RkStore::RkStore(const string& dirName) : m_dirName(dirName)
+{
+}
+
+
+bool RkStore::init()
+{
+    if (!makeDir(m_dirName) || !makeDir(m_dirName + "/images") || !makeDir(m_dirName + "/objects"))
+        return false;
+
+    for (int i = 0; i < 256; i++) {
+        ostringstream ss;
+        ss << m_dirName << "/objects/" << hex << setfill('0') << setw(2) << i;
+        if (!makeDir(ss.str()))
+            return false;
+    }
+
+    return true;
+}
+
+
+string RkStore::getObjectFileName(uint64_t hash)
+{
+    string hashStr = hashToString(hash);
+    return m_dirName + "/objects/" + hashStr.substr(0, 2) + "/" + hashStr;
+}
+
+
+string RkStore::getManifestFileName(const string& imageName)
+{
+    return m_dirName + "/images/" + imageName.substr(imageName.find_last_of("/\\:") + 1) + ".man";
+}
+
+
+bool RkStore::putObject(uint64_t hash, const uint8_t* data, size_t size, bool isFile)
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    if (isFile && m_fileObjects.insert(hash).second) {
+        ++m_stats.nUniqueFiles;
+        m_stats.uniqueFileBytes += size;
+    }
+
+    if (!m_objects.insert(hash).second)
+        return true;
+
+    m_stats.objectBytes += size;
+
+    string fileName = getObjectFileName(hash);
+
+    struct stat st;
+    if (!stat(fileName.c_str(), &st))
+        return (size_t)st.st_size == size;
+
+    ofstream f(fileName, ofstream::binary);
+    f.write((const char*)data, size);
+    f.close();
+    if (f.fail())
+        return false;
+
+    m_stats.newObjectBytes += size;
+
+    return true;
+}
+
+
+bool RkStore::getObject(uint64_t hash, vector<uint8_t>& data)
+{
+    ifstream f(getObjectFileName(hash), ifstream::binary);
+    if (f.fail())
+        return false;
+
+    f.seekg(0, ios_base::end);
+    size_t size = f.tellg();
+    f.seekg(0, ios_base::beg);
+
+    data.resize(size);
+    f.read((char*)data.data(), size);
+
+    return !f.fail() && hash64(data.data(), size) == hash;
+}
+
+
+bool RkStore::addImage(const string& imageFileName, ostream& log)
+{
+    log << imageFileName << ": ";
+
+    // manifests are named after image file names, images from different directories may collide
+    string manifestFileName = getManifestFileName(imageFileName);
+    string manifestKey = manifestFileName;
+    transform(manifestKey.begin(), manifestKey.end(), manifestKey.begin(), ::tolower);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (!m_manifests.insert(manifestKey).second) {
+            log << "image with the same name is already added, skipped!" << endl;
+            return false;
+        }
+    }
+
+    struct FileEntry {
+        string fileName;
+        string data;
+        vector<pair<int, int>> sectors;     // offset in the image and size
+    };
+
+    try {
+        RkVolume vol(imageFileName, IFM_READ_ONLY);
+
+        const uint8_t* image = vol.getImageData();
+        size_t imageSize = vol.getImageSize();
+
+        // files are taken from RK DOS images only, other images are stored as raw tracks
+        vector<FileEntry> files;
+        try {
+            if (vol.isValid()) {
+                for (const RkFileInfo& fi: *vol.getFileList()) {
+                    FileEntry file;
+                    file.fileName = fi.fileName;
+                    int left = fi.fileSize;
+                    for (const RkFileSector& sector: vol.getFileSectors(fi)) {
+                        if (sector.size <= left) {
+                            file.data.append((const char*)sector.data, sector.size);
+                            file.sectors.push_back({(int)(sector.data - image), sector.size});
+                            left -= sector.size;
+                        }
+                    }
+                    files.push_back(file);
+                }
+            }
+        }
+
+        catch (RkVolume::RkVolumeException&) {
+            files.clear();
+        }
+
+        ostringstream manifest;
+        manifest << "# rkdisk store manifest" << endl;
+        manifest << "image " << imageSize << " " << hashToString(hash64(image, imageSize)) << endl;
+
+        // file data is zeroed in the residual image, chunks are listed before files
+        vector<uint8_t> residual(image, image + imageSize);
+        ostringstream fileLines;
+        uint64_t fileBytes = 0;
+        bool ok = true;
+
+        for (const FileEntry& file: files) {
+            uint64_t hash = hash64(file.data.data(), file.data.size());
+            ok = putObject(hash, (const uint8_t*)file.data.data(), file.data.size(), true) && ok;
+
+            fileLines << "file " << hashToString(hash) << " " << file.data.size() << " " << file.sectors.size();
+            for (const auto& sector: file.sectors) {
+                fileLines << " " << sector.first << ":" << sector.second;
+                memset(residual.data() + sector.first, 0, sector.second);
+            }
+            fileLines << " " << file.fileName << endl;
+
+            fileBytes += file.data.size();
+        }
+
+        for (size_t offset = 0; offset < imageSize; offset += c_chunkSize) {
+            size_t size = min(imageSize - offset, (size_t)c_chunkSize);
+            uint64_t hash = hash64(residual.data() + offset, size);
+            ok = putObject(hash, residual.data() + offset, size, false) && ok;
+            manifest << "chunk " << offset << " " << size << " " << hashToString(hash) << endl;
+        }
+
+        manifest << fileLines.str();
+
+        if (!ok) {
+            log << "error writing objects!" << endl;
+            return false;
+        }
+
+        ofstream f(manifestFileName);
+        f << manifest.str();
+        f.close();
+        if (f.fail()) {
+            log << "error writing " << manifestFileName << "!" << endl;
+            return false;
+        }
+
+        log << files.size() << " file(s)";
+        if (files.empty() && !vol.isValid())
+            log << ", not an RK DOS image, stored as raw tracks";
+        log << endl;
+
+        lock_guard<mutex> lock(m_mutex);
+        ++m_stats.nImages;
+        m_stats.imageBytes += imageSize;
+        m_stats.nFiles += files.size();
+        m_stats.fileBytes += fileBytes;
+    }
+
+    catch (ImageFileException&) {
+        log << "file read error!" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool RkStore::rebuildImage(const string& imageName, vector<uint8_t>& data, ostream& log)
+{
+    string manifestFileName = getManifestFileName(imageName);
+    ifstream f(manifestFileName);
+    if (f.fail()) {
+        log << "image " << imageName << " not found in store!" << endl;
+        return false;
+    }
+
+    uint64_t imageHash = 0;
+    bool imageFound = false;
+    vector<uint8_t> object;
+
+    string line;
+    while (getline(f, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        istringstream ss(line);
+        string type;
+        ss >> type;
+
+        if (type == "image") {
+            size_t size;
+            if (!(ss >> size >> hex >> imageHash))
+                break;
+            data.assign(size, 0);
+            imageFound = true;
+        } else if (type == "file" && imageFound) {
+            uint64_t hash;
+            size_t size;
+            int nSectors;
+            if (!(ss >> hex >> hash >> dec >> size >> nSectors) || !getObject(hash, object) || object.size() != size) {
+                log << "bad or missing object: " << line << endl;
+                return false;
+            }
+            size_t pos = 0;
+            for (int i = 0; i < nSectors; i++) {
+                size_t offset, sectorSize;
+                char colon;
+                if (!(ss >> offset >> colon >> sectorSize) || colon != ':' ||
+                        offset + sectorSize > data.size() || pos + sectorSize > object.size()) {
+                    log << "bad manifest line: " << line << endl;
+                    return false;
+                }
+                memcpy(data.data() + offset, object.data() + pos, sectorSize);
+                pos += sectorSize;
+            }
+        } else if (type == "chunk" && imageFound) {
+            size_t offset, size;
+            uint64_t hash;
+            if (!(ss >> offset >> size >> hex >> hash) || offset + size > data.size()) {
+                log << "bad manifest line: " << line << endl;
+                return false;
+            }
+            if (!getObject(hash, object) || object.size() != size) {
+                log << "bad or missing object: " << line << endl;
+                return false;
+            }
+            memcpy(data.data() + offset, object.data(), size);
+        } else {
+            log << "bad manifest line: " << line << endl;
+            return false;
+        }
+    }
+
+    if (!imageFound || f.bad()) {
+        log << "bad manifest " << manifestFileName << "!" << endl;
+        return false;
+    }
+
+    if (hash64(data.data(), data.size()) != imageHash) {
+        log << "image checksum error!" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+RkStore::Stats RkStore::getStats()
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,81 @@
+/*
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RKSTORE_H
+#define RKSTORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <ostream>
+
+
+// Content-addressed store of RK DOS images.
+// Each file of an image is kept once as an object named by its content hash. The rest of the image
+// (track structure, directory, free sectors) is stored as per-track objects with file data zeroed,
+// so identical empty tracks are shared as well. A text manifest per image lists the objects
+// and the sectors file data is scattered to, the image is rebuilt from it byte for byte.
+//
+// store_dir/images/<image_file>.man - manifests, images are identified by file name without path:
+//                                     adding an image again replaces its manifest, but two images
+//                                     with the same name can't be added by one RkStore object
+// store_dir/objects/xx/xxxxxxxxxxxxxxxx - objects, xx is the first byte of the hash
+//
+// Methods are thread safe.
+class RkStore
+{
+public:
+    struct Stats {
+        int nImages = 0;
+        uint64_t imageBytes = 0;
+        int nFiles = 0;
+        uint64_t fileBytes = 0;
+        int nUniqueFiles = 0;       // distinct file contents among the added images
+        uint64_t uniqueFileBytes = 0;
+        uint64_t objectBytes = 0;   // size of distinct objects referenced by the added images
+        uint64_t newObjectBytes = 0;
+    };
+
+    explicit RkStore(const std::string& dirName);
+
+    bool init();
+
+    bool addImage(const std::string& imageFileName, std::ostream& log);
+    bool rebuildImage(const std::string& imageName, std::vector<uint8_t>& data, std::ostream& log);
+
+    Stats getStats();
+
+private:
+    std::string m_dirName;
+
+    std::mutex m_mutex;
+    std::set<uint64_t> m_objects;       // objects referenced so far
+    std::set<uint64_t> m_fileObjects;   // file objects referenced so far
+    std::set<std::string> m_manifests;  // manifests written so far, lower case
+    Stats m_stats;
+
+    std::string getObjectFileName(uint64_t hash);
+    std::string getManifestFileName(const std::string& imageName);
+
+    // returns false on write error or if a different object with the same hash exists
+    bool putObject(uint64_t hash, const uint8_t* data, size_t size, bool isFile);
+    bool getObject(uint64_t hash, std::vector<uint8_t>& data);
+};
+
+#endif // RKSTORE_H
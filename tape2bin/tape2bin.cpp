@@ -0,0 +1,361 @@
+/*
+ *  tape2bin v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <map>
+
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../bin2tape/bin2tape.h"
+#include "../bin2tape/tapedecoder.h"
+#include "../bin2tape/tapescanner.h"
+#include "../bin2tape/tapeindex.h"
+#include "../common/threadpool.h"
+#include "../common/outputnames.h"
+
+#define VERSION "1.00"
+
+
+using namespace std;
+
+void usage(string& moduleName)
+{
+            cout << "Usage: " << moduleName << " [options] tape_file|directory..." << endl <<
+            "       " << moduleName << " -s [options] dump_file..." << endl << endl <<
+            "Recognizes tape image format (rk*, rks, rko, bru/ord, cas, lvt), verifies" << endl <<
+            "its checksum and writes the program body as a binary file." << endl << endl <<
+            "options are:" << endl << endl <<
+            "  -o directory" << endl <<
+            "    output directory for binary files, default is current directory" << endl << endl <<
+            "  -c" << endl <<
+            "    check only, don't write binary files" << endl << endl <<
+            "  -f" << endl <<
+            "    write binary file even if checksum doesn't match" << endl << endl <<
+            "  -s" << endl <<
+            "    split mode: find all programs (CAS, LVT, RKO and E6-synced RK, RKM and RKS" << endl <<
+            "    blocks with valid checksums) in concatenated tape images or raw tape dumps," << endl <<
+            "    write each one to a separate tape image file and an index file dump_file.idx" << endl << endl <<
+            "  -j threads" << endl <<
+            "    number of worker threads, default = number of CPU cores" << endl << endl <<
+            "Directories are scanned for files with tape image extensions." << endl <<
+            "Binary file is named <name>.bin, or <name>.<ext>.bin if several input files" << endl <<
+            "have the same name (split mode files are named the same way: <name>.<ext>.idx)." << endl;
+}
+
+
+bool loadFile(const string& fileName, vector<uint8_t>& data)
+{
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail())
+        return false;
+
+    f.seekg(0, ios_base::end);
+    int size = f.tellg();
+    f.seekg(0, ios_base::beg);
+
+    data.resize(size);
+    f.read((char*)(data.data()), size);
+    if (f.fail())
+        return false;
+
+    f.close();
+
+    return true;
+}
+
+
+bool saveFile(const string& fileName, const uint8_t* data, size_t size)
+{
+    ofstream f(fileName, ofstream::binary);
+    if (f.fail())
+        return false;
+
+    f.write((const char*)data, size);
+    if (f.fail())
+        return false;
+
+    f.close();
+
+    return true;
+}
+
+
+string getFileExt(const string& fileName)
+{
+    size_t periodPos = fileName.find_last_of('.');
+    size_t slashPos = fileName.find_last_of("/\\:");
+    if (periodPos == string::npos || (slashPos != string::npos && periodPos < slashPos))
+        return "";
+    return fileName.substr(periodPos + 1);
+}
+
+
+void addInputFiles(const string& name, vector<string>& fileNames)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) || !S_ISDIR(st.st_mode)) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    DIR* dir = opendir(name.c_str());
+    if (!dir) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    vector<string> dirFiles;
+    while (dirent* entry = readdir(dir)) {
+        string fileName = entry->d_name;
+        TapeFileFormat format;
+        if (getFormatsByExt(getFileExt(fileName), &format))
+            dirFiles.push_back(name + "/" + fileName);
+    }
+    closedir(dir);
+
+    sort(dirFiles.begin(), dirFiles.end());
+    fileNames.insert(fileNames.end(), dirFiles.begin(), dirFiles.end());
+}
+
+
+bool processFile(const string& fileName, const string& binFileName, bool checkOnly, bool force, ostream& log)
+{
+    log << fileName << ": ";
+
+    vector<uint8_t> data;
+    if (!loadFile(fileName, data)) {
+        log << "file read error!" << endl;
+        return false;
+    }
+
+    TapeFileFormat preferredFormat;
+    int nPreferredFormats = getFormatsByExt(getFileExt(fileName), &preferredFormat);
+
+    TapeImageInfo info;
+    TapeDecodeResult res = decodeTape(data.data(), data.size(), info, &preferredFormat, nPreferredFormats);
+
+    if (res == TDR_UNKNOWN_FORMAT) {
+        log << "unknown format!" << endl;
+        return false;
+    }
+
+    log << txtFormats[info.format] << ", " << setfill('0') << uppercase << hex
+        << "load " << setw(4) << info.loadAddr << ", end " << setw(4) << info.endAddr << ", run " << setw(4) << info.runAddr;
+    if (!info.intFileName.empty())
+        log << ", name \"" << info.intFileName << "\"";
+
+    if (res == TDR_BAD_CHECKSUM) {
+        log << ", checksum error (" << setw(4) << info.storedCs << " instead of " << setw(4) << info.calculatedCs << ")";
+        if (!force) {
+            log << "!" << endl;
+            return false;
+        }
+    }
+
+    if (!checkOnly) {
+        if (!saveFile(binFileName, info.body, info.bodySize)) {
+            log << ", error writing " << binFileName << "!" << endl;
+            return false;
+        }
+        log << " -> " << binFileName;
+    }
+
+    log << endl;
+
+    return res == TDR_OK;
+}
+
+
+// Programs are written to <baseName>_NNN.<ext>, index to <baseName>.idx
+bool splitDump(const string& fileName, const string& baseName, bool checkOnly, ostream& log)
+{
+    log << fileName << ":" << endl;
+
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail()) {
+        log << "\tfile open error!" << endl;
+        return false;
+    }
+
+    ofstream indexFile;
+    if (!checkOnly) {
+        indexFile.open(baseName + ".idx");
+        if (indexFile.fail()) {
+            log << "\terror writing " << baseName << ".idx!" << endl;
+            return false;
+        }
+        writeTapeIndexHeader(indexFile);
+    }
+
+    TapeScanner scanner(f);
+
+    TapeImageInfo info;
+    uint64_t offset;
+    const uint8_t* image;
+    int n = 0;
+    bool ok = true;
+
+    while (scanner.findNext(info, offset, image)) {
+        ++n;
+
+        ostringstream numStr;
+        numStr << setfill('0') << setw(3) << n;
+
+        TapeIndexEntry entry = {offset, info.imageSize, info.format, info.loadAddr, info.endAddr, info.runAddr, info.intFileName, ""};
+        if (!checkOnly)
+            entry.fileName = baseName + "_" + numStr.str() + "." + getFormatExt(info.format);
+
+        log << "\t" << numStr.str() << " at " << dec << offset << ": " << txtFormats[info.format] << ", "
+            << setfill('0') << uppercase << hex
+            << "load " << setw(4) << info.loadAddr << ", end " << setw(4) << info.endAddr << ", run " << setw(4) << info.runAddr;
+        if (!info.intFileName.empty())
+            log << ", name \"" << info.intFileName << "\"";
+
+        if (!checkOnly) {
+            if (!saveFile(entry.fileName, image, info.imageSize)) {
+                log << ", error writing " << entry.fileName << "!" << endl;
+                ok = false;
+                continue;
+            }
+            log << " -> " << entry.fileName;
+            writeTapeIndexEntry(indexFile, n, entry);
+        }
+
+        log << endl;
+    }
+
+    log << "\t" << dec << n << " program(s) found" << endl;
+
+    return ok && n;
+}
+
+
+int main(int argc, const char** argv)
+{
+    static_assert(sizeof(RkFooter) == 5, "Packed structs required!");
+
+    cout << "tape2bin v. " VERSION " (c) Viktor Pykhonin, 2026" << endl << endl;
+    string moduleName = argv[0];
+    moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
+
+    string outputDir;
+    bool checkOnly = false;
+    bool force = false;
+    bool splitMode = false;
+    int nThreads = 0;
+    vector<string> fileNames;
+
+    // parse command line
+
+    if (argc < 2) {
+        usage(moduleName);
+        return 1;
+    }
+
+    int i = 1;
+    string option;
+    while (i < argc) {
+        option = argv[i];
+
+        if (option == "-o" || option == "-j") {
+            ++i;
+            if (i >= argc) {
+                usage(moduleName);
+                return 1;
+            }
+            if (option == "-o")
+                outputDir = argv[i];
+            else {
+                char* numEnd;
+                nThreads = strtoul(argv[i], &numEnd, 10);
+                if (*numEnd) {
+                    cout << "Invalid number of threads!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            }
+        } else if (option == "-c") {
+            checkOnly = true;
+        } else if (option == "-f") {
+            force = true;
+        } else if (option == "-s") {
+            splitMode = true;
+        } else if (option[0] == '-') {
+            cout << "Invalid option:" << option << endl << endl;
+            usage(moduleName);
+            return 1;
+        } else
+            fileNames.push_back(option);
+
+        ++i;
+    }
+
+    if (!splitMode) {
+        // expand directories
+        vector<string> names;
+        names.swap(fileNames);
+        for (const string& name: names)
+            addInputFiles(name, fileNames);
+    }
+
+    if (fileNames.empty()) {
+        cout << "No input files!" << endl << endl;
+        usage(moduleName);
+        return 1;
+    }
+
+    vector<string> baseNames(fileNames.size());
+    if (!checkOnly && !makeOutputBaseNames(fileNames, outputDir, baseNames))
+        return 1;
+
+    mutex coutMutex;
+    vector<bool> results(fileNames.size());
+
+    runParallel(fileNames.size(), [&](int n) {
+        ostringstream log;
+        bool ok = splitMode ? splitDump(fileNames[n], baseNames[n], checkOnly, log) :
+                              processFile(fileNames[n], baseNames[n] + ".bin", checkOnly, force, log);
+
+        lock_guard<mutex> lock(coutMutex);
+        results[n] = ok;
+        cout << log.str();
+    }, nThreads);
+
+    int nErrors = 0;
+    for (bool ok: results)
+        if (!ok)
+            ++nErrors;
+
+    cout << endl << dec << fileNames.size() - nErrors << " of " << fileNames.size() << " file(s) OK";
+    if (nErrors)
+        cout << ", " << nErrors << " failed";
+    cout << "." << endl;
+
+    return nErrors ? 1 : 0;
+}
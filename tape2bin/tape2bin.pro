@@ -0,0 +1,25 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    tape2bin.cpp \
+    ../bin2tape/tapedecoder.cpp \
+    ../bin2tape/tapeencoder.cpp \
+    ../bin2tape/tapeindex.cpp \
+    ../bin2tape/tapescanner.cpp
+
+HEADERS += \
+    ../bin2tape/bin2tape.h \
+    ../bin2tape/tapedecoder.h \
+    ../bin2tape/tapeencoder.h \
+    ../bin2tape/tapeformat.h \
+    ../bin2tape/tapeindex.h \
+    ../bin2tape/tapescanner.h \
+    ../common/outputnames.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
+
+QMAKE_LFLAGS += -static -static-libgcc
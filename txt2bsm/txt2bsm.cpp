@@ -0,0 +1,252 @@
+/*
+ *  txt2bsm v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../bsm2txt/bsmcodec.h"
+#include "../common/threadpool.h"
+#include "../common/outputnames.h"
+
+#define VERSION "1.00"
+
+
+using namespace std;
+
+
+void usage(string& moduleName)
+{
+            cout << "Usage: " << moduleName << " [options] file.txt|directory..." << endl << endl <<
+            "Converts text listings to tokenized BASIC programs file.bsm (inverse of bsm2txt)." << endl << endl <<
+            "options are:" << endl << endl <<
+            "  -o directory" << endl <<
+            "    output directory for bsm files, default is current directory" << endl << endl <<
+            "  -u" << endl <<
+            "    UTF-8 input, default is DOS encoding (cp866)" << endl << endl <<
+            "  -d dialect" << endl <<
+            "    BASIC dialect: micron (Basic Micron, default) or rk86 (Radio-86RK BASIC)" << endl << endl <<
+            "  -a addr" << endl <<
+            "    memory address of the first program line (hex) for line links, default = 2201" << endl << endl <<
+            "  -j threads" << endl <<
+            "    number of worker threads, default = number of CPU cores" << endl << endl <<
+            "Directories are scanned for .txt files. Tape file name is based on the input file name." << endl <<
+            "Output file is named <name>.bsm, or <name>.<ext>.bsm if several input files have" << endl <<
+            "the same name." << endl;
+}
+
+
+string getFileExt(const string& fileName)
+{
+    size_t periodPos = fileName.find_last_of('.');
+    size_t slashPos = fileName.find_last_of("/\\:");
+    if (periodPos == string::npos || (slashPos != string::npos && periodPos < slashPos))
+        return "";
+    return fileName.substr(periodPos + 1);
+}
+
+
+void addInputFiles(const string& name, vector<string>& fileNames)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) || !S_ISDIR(st.st_mode)) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    DIR* dir = opendir(name.c_str());
+    if (!dir) {
+        fileNames.push_back(name);
+        return;
+    }
+
+    vector<string> dirFiles;
+    while (dirent* entry = readdir(dir)) {
+        string fileName = entry->d_name;
+        string ext = getFileExt(fileName);
+        transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext == "txt")
+            dirFiles.push_back(name + "/" + fileName);
+    }
+    closedir(dir);
+
+    sort(dirFiles.begin(), dirFiles.end());
+    fileNames.insert(fileNames.end(), dirFiles.begin(), dirFiles.end());
+}
+
+
+// Program is written to <outBaseName>.bsm, tape file name is the input file name without extension
+bool processFile(const string& fileName, const string& outBaseName, BasicDialect dialect, TextEncoding encoding, uint16_t firstLineAddr, ostream& log)
+{
+    log << fileName << ": ";
+
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail()) {
+        log << "file read error!" << endl;
+        return false;
+    }
+
+    string fileNameWoPath = fileName.substr(fileName.find_last_of("/\\:") + 1);
+    string baseName = fileNameWoPath.substr(0, fileNameWoPath.find_last_of('.'));
+
+    // listing is read line by line, the program is built in one pass
+    vector<uint8_t> data;
+    int errorLine;
+    if (!tokenizeBsm(f, dialect, encoding, baseName, firstLineAddr, data, errorLine)) {
+        if (errorLine)
+            log << "syntax error in line " << errorLine << "!" << endl;
+        else
+            log << "file read error!" << endl;
+        return false;
+    }
+
+    string bsmFileName = outBaseName + ".bsm";
+
+    ofstream out(bsmFileName, ofstream::binary);
+    out.write((const char*)data.data(), data.size());
+    out.close();
+    if (out.fail()) {
+        log << "error writing " << bsmFileName << "!" << endl;
+        return false;
+    }
+
+    log << dec << data.size() << " bytes -> " << bsmFileName << endl;
+
+    return true;
+}
+
+
+int main(int argc, const char** argv)
+{
+    cout << "txt2bsm v. " VERSION " (c) Viktor Pykhonin, 2026" << endl << endl;
+    string moduleName = argv[0];
+    moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
+
+    string outputDir;
+    TextEncoding encoding = TE_CP866;
+    BasicDialect dialect = BD_MICRON;
+    uint16_t firstLineAddr = 0x2201;
+    int nThreads = 0;
+    vector<string> fileNames;
+
+    // parse command line
+
+    if (argc < 2) {
+        usage(moduleName);
+        return 1;
+    }
+
+    int i = 1;
+    string option;
+    while (i < argc) {
+        option = argv[i];
+
+        if (option == "-o" || option == "-j" || option == "-a" || option == "-d") {
+            ++i;
+            if (i >= argc) {
+                usage(moduleName);
+                return 1;
+            }
+            char* numEnd;
+            if (option == "-o")
+                outputDir = argv[i];
+            else if (option == "-a") {
+                unsigned long addr = strtoul(argv[i], &numEnd, 16);
+                if (*numEnd || !addr || addr > 0xFFFF) {
+                    cout << "Invalid address!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+                firstLineAddr = addr;
+            } else if (option == "-d") {
+                if (!parseBasicDialect(argv[i], dialect) || !canTokenize(dialect)) {
+                    cout << "Invalid dialect: " << argv[i] << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            } else {
+                nThreads = strtoul(argv[i], &numEnd, 10);
+                if (*numEnd) {
+                    cout << "Invalid number of threads!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            }
+        } else if (option == "-u") {
+            encoding = TE_UTF8;
+        } else if (option[0] == '-') {
+            cout << "Invalid option:" << option << endl << endl;
+            usage(moduleName);
+            return 1;
+        } else
+            fileNames.push_back(option);
+
+        ++i;
+    }
+
+    // expand directories
+    vector<string> names;
+    names.swap(fileNames);
+    for (const string& name: names)
+        addInputFiles(name, fileNames);
+
+    if (fileNames.empty()) {
+        cout << "No input files!" << endl << endl;
+        usage(moduleName);
+        return 1;
+    }
+
+    vector<string> baseNames(fileNames.size());
+    if (!makeOutputBaseNames(fileNames, outputDir, baseNames))
+        return 1;
+
+    mutex coutMutex;
+    vector<bool> results(fileNames.size());
+
+    runParallel(fileNames.size(), [&](int n) {
+        ostringstream log;
+        bool ok = processFile(fileNames[n], baseNames[n], dialect, encoding, firstLineAddr, log);
+
+        lock_guard<mutex> lock(coutMutex);
+        results[n] = ok;
+        cout << log.str();
+    }, nThreads);
+
+    int nErrors = 0;
+    for (bool ok: results)
+        if (!ok)
+            ++nErrors;
+
+    cout << endl << dec << fileNames.size() - nErrors << " of " << fileNames.size() << " file(s) OK";
+    if (nErrors)
+        cout << ", " << nErrors << " failed";
+    cout << "." << endl;
+
+    return nErrors ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    txt2bsm.cpp \
+    ../bsm2txt/bsmcodec.cpp
+
+HEADERS += \
+    ../bsm2txt/bsmcodec.h \
+    ../common/outputnames.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
+
+QMAKE_LFLAGS += -static -static-libgcc
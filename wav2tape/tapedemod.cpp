@@ -0,0 +1,388 @@
+/*
+ *  wav2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "tapedemod.h"
+
+
+using namespace std;
+
+
+static const double c_minThreshold = 300;        // signals below this level are treated as silence
+static const double c_thresholdRatio = 0.2;      // hysteresis threshold relative to the envelope
+static const double c_dcTime = 0.01;             // DC filter time constant, seconds
+static const double c_envelopeHalfLife = 0.05;   // seconds
+
+static const int c_minPilotPulses = 64;          // similar pulses in a row to lock on pilot or header tone
+static const double c_pilotTolerance = 0.25;
+static const double c_pllGain = 0.1;
+
+static const size_t c_maxBlockSize = 0x10000 + 0x200;  // larger than any tape image
+
+static const uint8_t c_syncByte = 0xE6;
+
+
+static uint32_t getLe(const uint8_t* p, int nBytes)
+{
+    uint32_t value = 0;
+    for (int i = nBytes - 1; i >= 0; i--)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+
+bool WavReader::readHeader()
+{
+    uint8_t riff[12];
+    if (!m_stream.read((char*)riff, sizeof(riff)) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4))
+        return false;
+
+    bool fmtFound = false;
+    for (;;) {
+        uint8_t chunk[8];
+        if (!m_stream.read((char*)chunk, sizeof(chunk)))
+            return false;
+        uint32_t size = getLe(chunk + 4, 4);
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            uint8_t fmt[16];
+            if (size < sizeof(fmt) || !m_stream.read((char*)fmt, sizeof(fmt)))
+                return false;
+            m_stream.ignore(size - sizeof(fmt) + (size & 1));
+
+            unsigned format = getLe(fmt, 2);
+            m_channels = getLe(fmt + 2, 2);
+            m_sampleRate = getLe(fmt + 4, 4);
+            unsigned bits = getLe(fmt + 14, 2);
+            if ((format != 1 && format != 0xFFFE) || !m_channels || !m_sampleRate || (bits != 8 && bits != 16))
+                return false;
+            m_bytesPerSample = bits / 8;
+            fmtFound = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            m_dataLeft = size;
+            return fmtFound;
+        } else
+            m_stream.ignore(size + (size & 1));
+    }
+}
+
+
+size_t WavReader::read(int16_t* samples, size_t maxSamples)
+{
+    size_t frameSize = m_channels * m_bytesPerSample;
+    size_t nFrames = min<uint64_t>(maxSamples, m_dataLeft / frameSize);
+    if (!nFrames)
+        return 0;
+
+    m_buf.resize(nFrames * frameSize);
+    m_stream.read((char*)m_buf.data(), m_buf.size());
+    nFrames = m_stream.gcount() / frameSize;
+    m_dataLeft = m_stream ? m_dataLeft - nFrames * frameSize : 0;
+
+    const uint8_t* p = m_buf.data();
+    for (size_t i = 0; i < nFrames; i++) {
+        int sum = 0;
+        for (unsigned ch = 0; ch < m_channels; ch++) {
+            sum += m_bytesPerSample == 1 ? (int(p[0]) - 128) << 8 : int16_t(p[0] | (p[1] << 8));
+            p += m_bytesPerSample;
+        }
+        samples[i] = sum / int(m_channels);
+    }
+
+    return nFrames;
+}
+
+
+PulseDetector::PulseDetector(unsigned sampleRate)
+{
+    m_dcAlpha = 1 / (sampleRate * c_dcTime);
+    m_envelopeDecay = pow(0.5, 1 / (sampleRate * c_envelopeHalfLife));
+}
+
+
+void PulseDetector::process(const int16_t* samples, size_t nSamples, vector<Pulse>& pulses)
+{
+    // silent blocks are skipped as a whole, min/max loop is vectorized by the compiler
+    int16_t minSample = 32767;
+    int16_t maxSample = -32768;
+    for (size_t i = 0; i < nSamples; i++) {
+        minSample = min(minSample, samples[i]);
+        maxSample = max(maxSample, samples[i]);
+    }
+    if (maxSample - minSample < c_minThreshold && m_envelope < c_minThreshold) {
+        m_sinceLast += nSamples;
+        m_dc = (minSample + maxSample) / 2.0;
+        m_envelope *= pow(m_envelopeDecay, double(nSamples));
+        m_prev = samples[nSamples - 1] - m_dc;
+        return;
+    }
+
+    // hysteresis comparator keeps state between samples, so this loop is sequential
+    for (size_t i = 0; i < nSamples; i++) {
+        double x = samples[i] - m_dc;
+        m_dc += x * m_dcAlpha;
+
+        double absX = fabs(x);
+        m_envelope = absX > m_envelope ? absX : m_envelope * m_envelopeDecay;
+        double threshold = max(m_envelope * c_thresholdRatio, c_minThreshold / 2);
+
+        m_sinceLast += 1;
+        if (m_high ? x < -threshold : x > threshold) {
+            // crossing position is interpolated between the previous and the current sample
+            double level = m_high ? -threshold : threshold;
+            double back = x != m_prev ? (x - level) / (x - m_prev) : 0;
+            back = min(max(back, 0.0), 1.0);
+
+            pulses.push_back({m_sinceLast - back, m_high});
+            m_sinceLast = back;
+            m_high = !m_high;
+        }
+        m_prev = x;
+    }
+}
+
+
+void PulseDetector::flush(vector<Pulse>& pulses)
+{
+    pulses.push_back({m_sinceLast, m_high});
+    m_sinceLast = 0;
+}
+
+
+// finds a run of pulses with similar width, returns average width or 0
+static double findTone(double width, int& count, double& sum)
+{
+    if (count && fabs(width - sum / count) > sum / count * c_pilotTolerance) {
+        count = 0;
+        sum = 0;
+    }
+
+    if (width < 2)
+        return 0;
+
+    ++count;
+    sum += width;
+
+    return count >= c_minPilotPulses ? sum / count : 0;
+}
+
+
+void BiphaseDemodulator::searchPilot(double width)
+{
+    m_halfPeriod = findTone(width, m_pilotCount, m_pilotSum);
+    if (m_halfPeriod)
+        m_state = DS_PILOT;
+}
+
+
+void BiphaseDemodulator::process(const Pulse& pulse, vector<TapeBlock>& blocks)
+{
+    double width = pulse.width;
+    m_time += width;
+
+    if (m_state == DS_SEARCH) {
+        searchPilot(width);
+        return;
+    }
+
+    // half-period is a transition in the middle of each bit, full period means the bit value changes
+    bool isShort = width > m_halfPeriod * 0.5 && width < m_halfPeriod * 1.5;
+    bool isLong = width >= m_halfPeriod * 1.5 && width < m_halfPeriod * 2.6;
+    if (!isShort && !isLong) {
+        reset(blocks);
+        searchPilot(width);
+        return;
+    }
+
+    m_halfPeriod += ((isShort ? width : width / 2) - m_halfPeriod) * c_pllGain;
+
+    bool levelAfter = !pulse.high;
+
+    if (m_state == DS_PILOT) {
+        if (isLong) {
+            // first 1 bit after the pilot zeros, this also gives the signal polarity
+            m_oneLevel = levelAfter;
+            m_midBit = true;
+            m_shift = 0;
+            m_nBits = 0;
+            m_state = DS_SYNC;
+            putBit(true, blocks);
+        }
+        return;
+    }
+
+    if (m_midBit) {
+        if (isShort)
+            m_midBit = false;
+        else
+            putBit(levelAfter == m_oneLevel, blocks);
+    } else {
+        if (isLong) {
+            reset(blocks);
+            return;
+        }
+        m_midBit = true;
+        putBit(levelAfter == m_oneLevel, blocks);
+    }
+}
+
+
+void BiphaseDemodulator::putBit(bool bit, vector<TapeBlock>& blocks)
+{
+    m_shift = (m_shift << 1) | bit;
+
+    if (m_state == DS_SYNC) {
+        if (m_shift == c_syncByte) {
+            m_state = DS_DATA;
+            m_nBits = 0;
+            m_block.fsk = false;
+            m_block.position = uint64_t(m_time);
+            m_block.data.clear();
+        } else if (++m_nBits > 64)
+            reset(blocks);
+        return;
+    }
+
+    if (++m_nBits == 8) {
+        m_block.data.push_back(m_shift);
+        m_nBits = 0;
+        if (m_block.data.size() >= c_maxBlockSize)
+            reset(blocks);
+    }
+}
+
+
+void BiphaseDemodulator::reset(vector<TapeBlock>& blocks)
+{
+    if (m_state == DS_DATA && !m_block.data.empty()) {
+        blocks.push_back(std::move(m_block));
+        m_block.data.clear();
+    }
+
+    m_state = DS_SEARCH;
+    m_pilotCount = 0;
+    m_pilotSum = 0;
+}
+
+
+void BiphaseDemodulator::finish(vector<TapeBlock>& blocks)
+{
+    reset(blocks);
+}
+
+
+void FskDemodulator::searchHeader(double width)
+{
+    m_shortWidth = findTone(width, m_headerCount, m_headerSum);
+    if (m_shortWidth)
+        m_state = DS_HEADER;
+}
+
+
+void FskDemodulator::process(const Pulse& pulse, vector<TapeBlock>& blocks)
+{
+    double width = pulse.width;
+    m_time += width;
+
+    if (m_state == DS_SEARCH) {
+        searchHeader(width);
+        return;
+    }
+
+    bool isShort = width > m_shortWidth * 0.5 && width < m_shortWidth * 1.5;
+    bool isLong = width >= m_shortWidth * 1.5 && width < m_shortWidth * 3;
+    if (!isShort && !isLong) {
+        reset(blocks);
+        searchHeader(width);
+        return;
+    }
+
+    m_shortWidth += ((isShort ? width : width / 2) - m_shortWidth) * c_pllGain;
+
+    if (m_state == DS_HEADER) {
+        if (isLong) {
+            // first half of the first start bit, bit boundaries are known from now
+            m_state = DS_IDLE;
+            m_units = 2;
+            m_longBit = true;
+            m_block.fsk = true;
+            m_block.position = uint64_t(m_time - width);
+            m_block.data.clear();
+        }
+        return;
+    }
+
+    if (!m_units)
+        m_longBit = isLong;
+    else if (m_longBit != isLong) {
+        reset(blocks);
+        return;
+    }
+
+    m_units += isLong ? 2 : 1;
+    if (m_units == 4) {
+        m_units = 0;
+        putBit(!m_longBit);
+        if (m_block.data.size() >= c_maxBlockSize)
+            reset(blocks);
+    }
+}
+
+
+void FskDemodulator::putBit(bool bit)
+{
+    if (m_state == DS_IDLE) {
+        if (!bit) {
+            m_state = DS_BYTE;
+            m_shift = 0;
+            m_nBits = 0;
+        }
+        return;
+    }
+
+    m_shift |= uint8_t(bit) << m_nBits;
+    if (++m_nBits == 8) {
+        m_block.data.push_back(m_shift);
+        m_state = DS_IDLE;
+    }
+}
+
+
+void FskDemodulator::reset(vector<TapeBlock>& blocks)
+{
+    if ((m_state == DS_IDLE || m_state == DS_BYTE) && !m_block.data.empty()) {
+        blocks.push_back(std::move(m_block));
+        m_block.data.clear();
+    }
+
+    m_state = DS_SEARCH;
+    m_headerCount = 0;
+    m_headerSum = 0;
+}
+
+
+void FskDemodulator::finish(vector<TapeBlock>& blocks)
+{
+    reset(blocks);
+}
@@ -0,0 +1,159 @@
+/*
+ *  wav2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#ifndef TAPEDEMOD_H
+#define TAPEDEMOD_H
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+
+// Reads PCM WAV files (8 or 16 bit, any number of channels) block by block,
+// channels are mixed down to mono
+class WavReader
+{
+public:
+    WavReader(std::istream& stream) : m_stream(stream) {}
+
+    // returns false if the stream is not a supported WAV file
+    bool readHeader();
+
+    unsigned getSampleRate() {return m_sampleRate;}
+
+    // returns number of samples read, 0 at the end of data
+    size_t read(int16_t* samples, size_t maxSamples);
+
+private:
+    std::istream& m_stream;
+    unsigned m_sampleRate = 0;
+    unsigned m_channels = 0;
+    unsigned m_bytesPerSample = 0;
+    uint64_t m_dataLeft = 0;
+    std::vector<uint8_t> m_buf;
+};
+
+
+// interval between two signal transitions
+struct Pulse {
+    double width;  // samples
+    bool high;     // signal level during the pulse
+};
+
+
+// Converts samples to pulses. DC offset is removed and the hysteresis threshold
+// follows the signal envelope, so recording level and polarity don't matter.
+class PulseDetector
+{
+public:
+    PulseDetector(unsigned sampleRate);
+
+    void process(const int16_t* samples, size_t nSamples, std::vector<Pulse>& pulses);
+
+    // emits the last pulse at the end of recording
+    void flush(std::vector<Pulse>& pulses);
+
+private:
+    double m_dc = 0;
+    double m_envelope = 0;
+    double m_dcAlpha;
+    double m_envelopeDecay;
+    double m_sinceLast = 0;  // samples since the last transition
+    double m_prev = 0;       // previous sample w/o DC
+    bool m_high = false;
+};
+
+
+// demodulated data block
+struct TapeBlock {
+    bool fsk = false;
+    uint64_t position = 0;      // sample number of the block start
+    std::vector<uint8_t> data;  // bytes after the sync byte (biphase) or after the header tone (FSK)
+};
+
+
+// RK86 family biphase demodulator: finds the 00 pilot tone, locks the PLL on it and
+// collects bytes after the E6 sync byte until the signal is lost
+class BiphaseDemodulator
+{
+public:
+    void process(const Pulse& pulse, std::vector<TapeBlock>& blocks);
+    void finish(std::vector<TapeBlock>& blocks);
+
+private:
+    enum State {
+        DS_SEARCH,  // waiting for pilot tone
+        DS_PILOT,   // bit clock is locked, waiting for the first 1 bit
+        DS_SYNC,    // waiting for the sync byte
+        DS_DATA
+    };
+
+    State m_state = DS_SEARCH;
+    double m_time = 0;
+    int m_pilotCount = 0;
+    double m_pilotSum = 0;
+    double m_halfPeriod = 0;  // PLL estimate of the half bit period
+    bool m_midBit = false;    // last transition was in the middle of a bit
+    bool m_oneLevel = false;  // signal level of the second half of 1 bit
+    uint8_t m_shift = 0;
+    int m_nBits = 0;
+    TapeBlock m_block;
+
+    void searchPilot(double width);
+    void putBit(bool bit, std::vector<TapeBlock>& blocks);
+    void reset(std::vector<TapeBlock>& blocks);
+};
+
+
+// MSX compatible FSK demodulator (CAS, LVT): 0 = one 1200 Hz period, 1 = two 2400 Hz
+// periods, each byte is a start bit, 8 data bits LSB first and stop bits. Each block
+// starts after a header tone and ends when the signal is lost.
+class FskDemodulator
+{
+public:
+    void process(const Pulse& pulse, std::vector<TapeBlock>& blocks);
+    void finish(std::vector<TapeBlock>& blocks);
+
+private:
+    enum State {
+        DS_SEARCH,  // waiting for header tone
+        DS_HEADER,  // header tone, waiting for the first start bit
+        DS_IDLE,    // waiting for a start bit
+        DS_BYTE
+    };
+
+    State m_state = DS_SEARCH;
+    double m_time = 0;
+    int m_headerCount = 0;
+    double m_headerSum = 0;
+    double m_shortWidth = 0;  // PLL estimate of the 2400 Hz half-period
+    int m_units = 0;          // collected half-periods of the current bit, long = 2
+    bool m_longBit = false;
+    uint8_t m_shift = 0;
+    int m_nBits = 0;
+    TapeBlock m_block;
+
+    void searchHeader(double width);
+    void putBit(bool bit);
+    void reset(std::vector<TapeBlock>& blocks);
+};
+
+#endif // TAPEDEMOD_H
@@ -0,0 +1,355 @@
+/*
+ *  wav2tape v. 1.0
+ *  (c) Viktor Pykhonin <pyk@mail.ru>, 2026
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/vpyk/EmuUtils
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "../bin2tape/bin2tape.h"
+#include "../bin2tape/tapedecoder.h"
+#include "../bin2tape/tapeindex.h"
+#include "../common/threadpool.h"
+#include "../common/outputnames.h"
+#include "tapedemod.h"
+
+#define VERSION "1.00"
+
+
+using namespace std;
+
+void usage(string& moduleName)
+{
+            cout << "Usage: " << moduleName << " [options] wav_file..." << endl << endl <<
+            "Decodes tape recordings (PCM WAV, 8 or 16 bit) into tape image files." << endl <<
+            "RK86 family (rk*, rks, rko) and MSX compatible (cas, lvt) recordings are" << endl <<
+            "recognized, each found program is verified and written to a separate file" << endl <<
+            "wav_file_NNN.ext, index is written to wav_file.idx (offsets are sample numbers)." << endl <<
+            "If several input files have the same name, the extension is kept: wav_file.ext_NNN.ext." << endl << endl <<
+            "options are:" << endl << endl <<
+            "  -o directory" << endl <<
+            "    output directory, default is current directory" << endl << endl <<
+            "  -t format" << endl <<
+            "    preferred format if the recording fits several RK family formats" << endl << endl <<
+            "  -c" << endl <<
+            "    check only, don't write files" << endl << endl <<
+            "  -f" << endl <<
+            "    write images even if checksum doesn't match" << endl << endl <<
+            "  -j threads" << endl <<
+            "    number of worker threads, default = number of CPU cores" << endl;
+}
+
+
+bool saveFile(const string& fileName, const uint8_t* data, size_t size)
+{
+    ofstream f(fileName, ofstream::binary);
+    if (f.fail())
+        return false;
+
+    f.write((const char*)data, size);
+    if (f.fail())
+        return false;
+
+    f.close();
+
+    return true;
+}
+
+
+// MSX file header block: 10 identical type bytes (D0 - binary) and a name
+bool isCasHeaderBlock(const vector<uint8_t>& data)
+{
+    if (data.size() < 16 || data[0] != 0xD0)
+        return false;
+    for (int i = 1; i < 10; i++)
+        if (data[i] != data[0])
+            return false;
+    return true;
+}
+
+
+struct WavOutput {
+    string baseName;
+    unsigned sampleRate;
+    bool checkOnly;
+    bool force;
+    ofstream indexFile;
+    int n = 0;
+    bool ok = true;
+};
+
+
+// Recognizes a tape image in the demodulated data and writes it
+void outputImage(WavOutput& out, uint64_t position, const vector<uint8_t>& data, const TapeFileFormat* preferredFormats,
+                 int nPreferredFormats, ostream& log)
+{
+    TapeImageInfo info;
+    TapeDecodeResult res = decodeTape(data.data(), data.size(), info, preferredFormats, nPreferredFormats);
+    if (res == TDR_UNKNOWN_FORMAT)
+        return;  // noise or unsupported data
+
+    ++out.n;
+
+    ostringstream numStr;
+    numStr << setfill('0') << setw(3) << out.n;
+
+    TapeIndexEntry entry = {position, info.imageSize, info.format, info.loadAddr, info.endAddr, info.runAddr, info.intFileName, ""};
+    if (!out.checkOnly)
+        entry.fileName = out.baseName + "_" + numStr.str() + "." + getFormatExt(info.format);
+
+    log << "\t" << numStr.str() << " at " << fixed << setprecision(1) << double(position) / out.sampleRate << " s: "
+        << txtFormats[info.format] << ", " << setfill('0') << uppercase << hex
+        << "load " << setw(4) << info.loadAddr << ", end " << setw(4) << info.endAddr << ", run " << setw(4) << info.runAddr;
+    if (!info.intFileName.empty())
+        log << ", name \"" << info.intFileName << "\"";
+
+    if (res == TDR_BAD_CHECKSUM) {
+        log << ", checksum error (" << setw(4) << info.storedCs << " instead of " << setw(4) << info.calculatedCs << ")";
+        out.ok = false;
+        if (!out.force) {
+            log << "!" << endl;
+            return;
+        }
+    }
+
+    if (!out.checkOnly) {
+        if (!saveFile(entry.fileName, data.data() + info.imageOffset, info.imageSize)) {
+            log << ", error writing " << entry.fileName << "!" << endl;
+            out.ok = false;
+            return;
+        }
+        log << " -> " << entry.fileName;
+        writeTapeIndexEntry(out.indexFile, out.n, entry);
+    }
+
+    log << endl;
+}
+
+
+// Programs are written to <baseName>_NNN.<ext>, index to <baseName>.idx
+bool processWav(const string& fileName, const string& baseName, bool checkOnly, bool force,
+                const TapeFileFormat* preferredFormats, int nPreferredFormats, ostream& log)
+{
+    log << fileName << ":" << endl;
+
+    ifstream f(fileName, ifstream::binary);
+    if (f.fail()) {
+        log << "\tfile open error!" << endl;
+        return false;
+    }
+
+    WavReader reader(f);
+    if (!reader.readHeader()) {
+        log << "\tnot a PCM WAV file!" << endl;
+        return false;
+    }
+
+    WavOutput out;
+    out.sampleRate = reader.getSampleRate();
+    out.checkOnly = checkOnly;
+    out.force = force;
+
+    out.baseName = baseName;
+
+    if (!checkOnly) {
+        out.indexFile.open(out.baseName + ".idx");
+        if (out.indexFile.fail()) {
+            log << "\terror writing " << out.baseName << ".idx!" << endl;
+            return false;
+        }
+        writeTapeIndexHeader(out.indexFile);
+    }
+
+    PulseDetector detector(reader.getSampleRate());
+    BiphaseDemodulator biphase;
+    FskDemodulator fsk;
+
+    static const size_t c_blockSamples = 0x10000;
+    vector<int16_t> samples(c_blockSamples);
+    vector<Pulse> pulses;
+    vector<TapeBlock> blocks;
+
+    // CAS file header block waiting for its data block
+    TapeBlock casHeader;
+    bool casHeaderFound = false;
+
+    vector<uint8_t> image;
+
+    bool eof = false;
+    while (!eof) {
+        pulses.clear();
+        size_t nSamples = reader.read(samples.data(), c_blockSamples);
+        if (nSamples)
+            detector.process(samples.data(), nSamples, pulses);
+        else {
+            detector.flush(pulses);
+            eof = true;
+        }
+
+        for (const Pulse& pulse: pulses) {
+            biphase.process(pulse, blocks);
+            fsk.process(pulse, blocks);
+        }
+        if (eof) {
+            biphase.finish(blocks);
+            fsk.finish(blocks);
+        }
+
+        for (TapeBlock& block: blocks) {
+            if (!block.fsk) {
+                outputImage(out, block.position, block.data, preferredFormats, nPreferredFormats, log);
+            } else if (isCasHeaderBlock(block.data)) {
+                casHeader = std::move(block);
+                casHeaderFound = true;
+            } else if (casHeaderFound) {
+                // restore CAS block signatures, each block starts at 8 bytes boundary
+                image.assign(casSignature, casSignature + sizeof(casSignature));
+                image.insert(image.end(), casHeader.data.begin(), casHeader.data.end());
+                image.resize((image.size() + 7) & ~size_t(7), 0);
+                image.insert(image.end(), casSignature, casSignature + sizeof(casSignature));
+                image.insert(image.end(), block.data.begin(), block.data.end());
+                static const TapeFileFormat cas = TFF_CAS;
+                outputImage(out, casHeader.position, image, &cas, 1, log);
+                casHeaderFound = false;
+            } else if (block.data[0] == 0xD0) {
+                image.assign(lvtSignature, lvtSignature + sizeof(lvtSignature));
+                image.insert(image.end(), block.data.begin(), block.data.end());
+                static const TapeFileFormat lvt = TFF_LVT;
+                outputImage(out, block.position, image, &lvt, 1, log);
+            }
+        }
+        blocks.clear();
+    }
+
+    if (f.bad()) {
+        log << "\tfile read error!" << endl;
+        return false;
+    }
+
+    log << "\t" << dec << out.n << " program(s) found" << endl;
+
+    return out.ok && out.n;
+}
+
+
+int main(int argc, const char** argv)
+{
+    cout << "wav2tape v. " VERSION " (c) Viktor Pykhonin, 2026" << endl << endl;
+    string moduleName = argv[0];
+    moduleName = moduleName.substr(moduleName.find_last_of("/\\:") + 1);
+
+    string outputDir;
+    bool checkOnly = false;
+    bool force = false;
+    int nThreads = 0;
+    TapeFileFormat preferredFormat = TFF_RK;
+    int nPreferredFormats = 0;
+    vector<string> fileNames;
+
+    // parse command line
+
+    if (argc < 2) {
+        usage(moduleName);
+        return 1;
+    }
+
+    int i = 1;
+    string option;
+    while (i < argc) {
+        option = argv[i];
+
+        if (option == "-o" || option == "-j" || option == "-t") {
+            ++i;
+            if (i >= argc) {
+                usage(moduleName);
+                return 1;
+            }
+            if (option == "-o")
+                outputDir = argv[i];
+            else if (option == "-t") {
+                nPreferredFormats = getFormatsByExt(argv[i], &preferredFormat);
+                if (!nPreferredFormats) {
+                    cout << "Invalid format specification!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            } else {
+                char* numEnd;
+                nThreads = strtoul(argv[i], &numEnd, 10);
+                if (*numEnd) {
+                    cout << "Invalid number of threads!" << endl << endl;
+                    usage(moduleName);
+                    return 1;
+                }
+            }
+        } else if (option == "-c") {
+            checkOnly = true;
+        } else if (option == "-f") {
+            force = true;
+        } else if (option[0] == '-') {
+            cout << "Invalid option:" << option << endl << endl;
+            usage(moduleName);
+            return 1;
+        } else
+            fileNames.push_back(option);
+
+        ++i;
+    }
+
+    if (fileNames.empty()) {
+        cout << "No input files!" << endl << endl;
+        usage(moduleName);
+        return 1;
+    }
+
+    vector<string> baseNames(fileNames.size());
+    if (!checkOnly && !makeOutputBaseNames(fileNames, outputDir, baseNames))
+        return 1;
+
+    mutex coutMutex;
+    vector<bool> results(fileNames.size());
+
+    runParallel(fileNames.size(), [&](int n) {
+        ostringstream log;
+        bool ok = processWav(fileNames[n], baseNames[n], checkOnly, force, &preferredFormat, nPreferredFormats, log);
+
+        lock_guard<mutex> lock(coutMutex);
+        results[n] = ok;
+        cout << log.str();
+    }, nThreads);
+
+    int nErrors = 0;
+    for (bool ok: results)
+        if (!ok)
+            ++nErrors;
+
+    cout << endl << dec << fileNames.size() - nErrors << " of " << fileNames.size() << " file(s) OK";
+    if (nErrors)
+        cout << ", " << nErrors << " failed";
+    cout << "." << endl;
+
+    return nErrors ? 1 : 0;
+}
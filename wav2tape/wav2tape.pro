@@ -0,0 +1,25 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    wav2tape.cpp \
+    tapedemod.cpp \
+    ../bin2tape/tapedecoder.cpp \
+    ../bin2tape/tapeencoder.cpp \
+    ../bin2tape/tapeindex.cpp
+
+HEADERS += \
+    tapedemod.h \
+    ../bin2tape/bin2tape.h \
+    ../bin2tape/tapedecoder.h \
+    ../bin2tape/tapeencoder.h \
+    ../bin2tape/tapeformat.h \
+    ../bin2tape/tapeindex.h \
+    ../common/outputnames.h \
+    ../common/threadpool.h
+
+LIBS += -pthread
+
+QMAKE_LFLAGS += -static -static-libgcc